@@ -8,15 +8,30 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <inttypes.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __cplusplus
+#define THREAD_LOCAL thread_local
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
 // utils -----------------------------------------------------------------------
 
+static void (*error_hook)(char const *msg) = NULL;
+
+void JSON_SetErrorHook(void (*hook)(char const *msg)) {
+    error_hook = hook;
+}
+
 void print_error(char const *msg) {
-    fprintf(stderr, "error: ");
-    fprintf(stderr, "%s\n", msg);
+    if (error_hook) error_hook(msg);
 }
 
 // JSON specification doesn't include all characters identified as whitespace by
@@ -28,6 +43,108 @@ bool char_isdigit(char c) {
     return '0' <= c && c <= '9';
 }
 
+// Maximum nesting of arrays and objects accepted by the parser and validator,
+// keeping their stack usage bounded.
+#define MAX_DEPTH 1024
+
+// Length of run at start of `str` of characters which appear in a string as
+// is, i.e. not '"', '\\', a control character or part of a UTF-8 sequence.
+// Checks 8 bytes at a time, for plain ASCII text this is most of a string.
+static size_t str_plain_len(char const *str, size_t len) {
+    uint64_t const ones = 0x0101010101010101ULL;
+    uint64_t const highs = 0x8080808080808080ULL;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, 8);
+        uint64_t const quote = word ^ (ones * '"');
+        uint64_t const slash = word ^ (ones * '\\');
+        // High bit of a byte is set if it is 0 after the xor, below 0x20 or
+        // already at least 0x80.
+        if ((((quote - ones) & ~quote)
+                    | ((slash - ones) & ~slash)
+                    | ((word - ones * 0x20) & ~word)
+                    | word) & highs)
+            break;
+    }
+    for (; i < len; ++i) {
+        unsigned char const c = str[i];
+        if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80) break;
+    }
+    return i;
+}
+
+// Length of the UTF-8 sequence of 2 to 4 bytes at start of `str`, or 0 if it is
+// invalid; overlong encodings and surrogates are invalid.
+static size_t utf8_sequence_len(char const *str, size_t len) {
+    unsigned char const *bytes = (unsigned char const*)str;
+    size_t seq_len;
+    uint32_t code, min;
+    if (bytes[0] >= 0xc2 && bytes[0] <= 0xdf) {
+        seq_len = 2; code = bytes[0] & 0x1f; min = 0x80;
+    } else if ((bytes[0] & 0xf0) == 0xe0) {
+        seq_len = 3; code = bytes[0] & 0x0f; min = 0x800;
+    } else if (bytes[0] >= 0xf0 && bytes[0] <= 0xf4) {
+        seq_len = 4; code = bytes[0] & 0x07; min = 0x10000;
+    } else return 0;
+    if (len < seq_len) return 0;
+    for (size_t i = 1; i < seq_len; ++i) {
+        if ((bytes[i] & 0xc0) != 0x80) return 0;
+        code = (code << 6) | (bytes[i] & 0x3f);
+    }
+    if (code < min || code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff))
+        return 0;
+    return seq_len;
+}
+
+static bool hex4_value(char const *str, size_t len, uint32_t *val) {
+    if (len < 4) return false;
+    *val = 0;
+    for (int i = 0; i < 4; ++i) {
+        char const c = str[i];
+        uint32_t digit;
+        if      ('0' <= c && c <= '9') digit = c - '0';
+        else if ('a' <= c && c <= 'f') digit = c - 'a' + 10;
+        else if ('A' <= c && c <= 'F') digit = c - 'A' + 10;
+        else return false;
+        *val = (*val << 4) | digit;
+    }
+    return true;
+}
+
+// Length of the escape sequence following a '\\' at start of `str`, storing
+// the code point it represents in `code`; 0 if the sequence is invalid.
+// NOTE: A \u escape of a high surrogate must be followed by one of a low
+//       surrogate, lone surrogates can't be represented in UTF-8.
+static size_t escape_len(char const *str, size_t len, uint32_t *code) {
+    if (len == 0) return 0;
+    switch (str[0]) {
+    case '"':  *code = '"';  return 1;
+    case '\\': *code = '\\'; return 1;
+    case '/':  *code = '/';  return 1;
+    case 'b':  *code = '\b'; return 1;
+    case 'f':  *code = '\f'; return 1;
+    case 'n':  *code = '\n'; return 1;
+    case 'r':  *code = '\r'; return 1;
+    case 't':  *code = '\t'; return 1;
+    case 'u': {
+        uint32_t high, low;
+        if (!hex4_value(str + 1, len - 1, &high)) return 0;
+        if (high < 0xd800 || high > 0xdfff) {
+            *code = high;
+            return 5;
+        }
+        if (high > 0xdbff || len < 11 || str[5] != '\\' || str[6] != 'u'
+                || !hex4_value(str + 7, len - 7, &low)
+                || low < 0xdc00 || low > 0xdfff)
+            return 0;
+        *code = 0x10000 + ((high - 0xd800) << 10) + (low - 0xdc00);
+        } return 11;
+    default:
+        return 0;
+    }
+}
+
 bool str_prefix(char const *str, char const *prefix) {
     while (*prefix)
         if (*(str++) != *(prefix++))
@@ -40,6 +157,30 @@ int str_prefix_len(char const *str, char const *prefix) {
     return 0;
 }
 
+static uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Fast non-cryptographic 64-bit hash reading input 8 bytes at a time.
+static uint64_t hash_bytes(void const *data, size_t len, uint64_t seed) {
+    unsigned char const *bytes = (unsigned char const*)data;
+    uint64_t h = seed ^ (len * 0x9e3779b97f4a7c15ULL);
+    uint64_t word;
+    for (; len >= 8; len -= 8, bytes += 8) {
+        memcpy(&word, bytes, 8);
+        h = (h ^ hash_mix(word)) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    word = 0;
+    memcpy(&word, bytes, len);
+    return hash_mix(h ^ hash_mix(word));
+}
+
 typedef struct CBuf {
     char *items;
     size_t size;
@@ -91,6 +232,49 @@ bool cbuf_append_str(CBuf *buf, char const *str) {
     return true;
 }
 
+static bool cbuf_append_bytes(CBuf *buf, void const *data, size_t len) {
+    while (buf->size + len >= buf->capacity)
+        if (!cbuf_grow(buf))
+            return false;
+    memcpy(buf->items + buf->size, data, len);
+    buf->size += len;
+    return true;
+}
+
+// Append unsigned LEB128 encoding of `val`.
+static bool cbuf_append_varint(CBuf *buf, uint64_t val) {
+    while (val >= 0x80) {
+        if (!cbuf_append(buf, (char)((val & 0x7f) | 0x80))) return false;
+        val >>= 7;
+    }
+    return cbuf_append(buf, (char)val);
+}
+
+static bool cbuf_append_utf8(CBuf *buf, uint32_t code) {
+    char bytes[4];
+    size_t len;
+    if (code < 0x80) {
+        bytes[0] = (char)code;
+        len = 1;
+    } else if (code < 0x800) {
+        bytes[0] = (char)(0xc0 | (code >> 6));
+        bytes[1] = (char)(0x80 | (code & 0x3f));
+        len = 2;
+    } else if (code < 0x10000) {
+        bytes[0] = (char)(0xe0 | (code >> 12));
+        bytes[1] = (char)(0x80 | ((code >> 6) & 0x3f));
+        bytes[2] = (char)(0x80 | (code & 0x3f));
+        len = 3;
+    } else {
+        bytes[0] = (char)(0xf0 | (code >> 18));
+        bytes[1] = (char)(0x80 | ((code >> 12) & 0x3f));
+        bytes[2] = (char)(0x80 | ((code >> 6) & 0x3f));
+        bytes[3] = (char)(0x80 | (code & 0x3f));
+        len = 4;
+    }
+    return cbuf_append_bytes(buf, bytes, len);
+}
+
 char *cbuf_print(CBuf const *buf) {
     char *str = (char*)malloc(buf->size + 1);
     if (!str) {
@@ -109,6 +293,238 @@ void cbuf_delete(CBuf *buf) {
     buf->size = buf->capacity = 0;
 }
 
+// number printing -------------------------------------------------------------
+//
+// Doubles are converted to the shortest digits that read back as the same value
+// in a single pass with Grisu2 (Florian Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers", 2010). The value and its
+// rounding boundaries are scaled by a cached power of ten into 64 bit fixed
+// point, then digits are generated until they fall within the boundaries.
+
+typedef struct DiyFp {
+    uint64_t f;
+    int e;
+} DiyFp;
+
+// Normalized 10^k as f * 2^e for k = -348, -340, ..., 340.
+static DiyFp const cached_powers[] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, {0xbaaee17fa23ebf76ULL, -1193},
+    {0x8b16fb203055ac76ULL, -1166}, {0xcf42894a5dce35eaULL, -1140},
+    {0x9a6bb0aa55653b2dULL, -1113}, {0xe61acf033d1a45dfULL, -1087},
+    {0xab70fe17c79ac6caULL, -1060}, {0xff77b1fcbebcdc4fULL, -1034},
+    {0xbe5691ef416bd60cULL, -1007}, {0x8dd01fad907ffc3cULL, -980},
+    {0xd3515c2831559a83ULL, -954}, {0x9d71ac8fada6c9b5ULL, -927},
+    {0xea9c227723ee8bcbULL, -901}, {0xaecc49914078536dULL, -874},
+    {0x823c12795db6ce57ULL, -847}, {0xc21094364dfb5637ULL, -821},
+    {0x9096ea6f3848984fULL, -794}, {0xd77485cb25823ac7ULL, -768},
+    {0xa086cfcd97bf97f4ULL, -741}, {0xef340a98172aace5ULL, -715},
+    {0xb23867fb2a35b28eULL, -688}, {0x84c8d4dfd2c63f3bULL, -661},
+    {0xc5dd44271ad3cdbaULL, -635}, {0x936b9fcebb25c996ULL, -608},
+    {0xdbac6c247d62a584ULL, -582}, {0xa3ab66580d5fdaf6ULL, -555},
+    {0xf3e2f893dec3f126ULL, -529}, {0xb5b5ada8aaff80b8ULL, -502},
+    {0x87625f056c7c4a8bULL, -475}, {0xc9bcff6034c13053ULL, -449},
+    {0x964e858c91ba2655ULL, -422}, {0xdff9772470297ebdULL, -396},
+    {0xa6dfbd9fb8e5b88fULL, -369}, {0xf8a95fcf88747d94ULL, -343},
+    {0xb94470938fa89bcfULL, -316}, {0x8a08f0f8bf0f156bULL, -289},
+    {0xcdb02555653131b6ULL, -263}, {0x993fe2c6d07b7facULL, -236},
+    {0xe45c10c42a2b3b06ULL, -210}, {0xaa242499697392d3ULL, -183},
+    {0xfd87b5f28300ca0eULL, -157}, {0xbce5086492111aebULL, -130},
+    {0x8cbccc096f5088ccULL, -103}, {0xd1b71758e219652cULL, -77},
+    {0x9c40000000000000ULL, -50}, {0xe8d4a51000000000ULL, -24},
+    {0xad78ebc5ac620000ULL, 3}, {0x813f3978f8940984ULL, 30},
+    {0xc097ce7bc90715b3ULL, 56}, {0x8f7e32ce7bea5c70ULL, 83},
+    {0xd5d238a4abe98068ULL, 109}, {0x9f4f2726179a2245ULL, 136},
+    {0xed63a231d4c4fb27ULL, 162}, {0xb0de65388cc8ada8ULL, 189},
+    {0x83c7088e1aab65dbULL, 216}, {0xc45d1df942711d9aULL, 242},
+    {0x924d692ca61be758ULL, 269}, {0xda01ee641a708deaULL, 295},
+    {0xa26da3999aef774aULL, 322}, {0xf209787bb47d6b85ULL, 348},
+    {0xb454e4a179dd1877ULL, 375}, {0x865b86925b9bc5c2ULL, 402},
+    {0xc83553c5c8965d3dULL, 428}, {0x952ab45cfa97a0b3ULL, 455},
+    {0xde469fbd99a05fe3ULL, 481}, {0xa59bc234db398c25ULL, 508},
+    {0xf6c69a72a3989f5cULL, 534}, {0xb7dcbf5354e9beceULL, 561},
+    {0x88fcf317f22241e2ULL, 588}, {0xcc20ce9bd35c78a5ULL, 614},
+    {0x98165af37b2153dfULL, 641}, {0xe2a0b5dc971f303aULL, 667},
+    {0xa8d9d1535ce3b396ULL, 694}, {0xfb9b7cd9a4a7443cULL, 720},
+    {0xbb764c4ca7a44410ULL, 747}, {0x8bab8eefb6409c1aULL, 774},
+    {0xd01fef10a657842cULL, 800}, {0x9b10a4e5e9913129ULL, 827},
+    {0xe7109bfba19c0c9dULL, 853}, {0xac2820d9623bf429ULL, 880},
+    {0x80444b5e7aa7cf85ULL, 907}, {0xbf21e44003acdd2dULL, 933},
+    {0x8e679c2f5e44ff8fULL, 960}, {0xd433179d9c8cb841ULL, 986},
+    {0x9e19db92b4e31ba9ULL, 1013}, {0xeb96bf6ebadf77d9ULL, 1039},
+    {0xaf87023b9bf0ee6bULL, 1066},
+};
+
+static DiyFp diyfp_mul(DiyFp const a, DiyFp const b) {
+    uint64_t const m32 = 0xffffffffULL;
+    uint64_t const ah = a.f >> 32, al = a.f & m32;
+    uint64_t const bh = b.f >> 32, bl = b.f & m32;
+    uint64_t const hl = ah * bl, lh = al * bh;
+    uint64_t tmp = ((al * bl) >> 32) + (hl & m32) + (lh & m32);
+    tmp += 1ULL << 31; // Round.
+    DiyFp const r = {ah * bh + (hl >> 32) + (lh >> 32) + (tmp >> 32),
+        a.e + b.e + 64};
+    return r;
+}
+
+static DiyFp diyfp_normalize(DiyFp d) {
+    while (!(d.f & (1ULL << 63))) {
+        d.f <<= 1;
+        --d.e;
+    }
+    return d;
+}
+
+static void grisu_round(char * const digits, int const len, uint64_t const delta,
+        uint64_t rest, uint64_t const ten_kappa, uint64_t const wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa
+            && (rest + ten_kappa < wp_w
+                || wp_w - rest > rest + ten_kappa - wp_w)) {
+        --digits[len - 1];
+        rest += ten_kappa;
+    }
+}
+
+// Write shortest digits of positive finite `num` to `digits`, value is the
+// digits times 10^`*exp`; return number of digits, 17 at most.
+static int grisu2(double const num, char * const digits, int * const exp) {
+    static uint64_t const pow10[] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+        10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+        100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+        100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+        100000000000000000ULL, 1000000000000000000ULL,
+        10000000000000000000ULL,
+    };
+    uint64_t bits;
+    memcpy(&bits, &num, sizeof(bits));
+    int const biased = (int)(bits >> 52) & 0x7ff;
+    DiyFp v = {bits & 0xfffffffffffffULL, 1 - 1075};
+    if (biased) {
+        v.f |= 1ULL << 52;
+        v.e = biased - 1075;
+    }
+
+    // Boundaries halfway to the neighbouring doubles, sharing an exponent.
+    DiyFp plus = {(v.f << 1) + 1, v.e - 1};
+    while (!(plus.f & (1ULL << 53))) {
+        plus.f <<= 1;
+        --plus.e;
+    }
+    plus.f <<= 10;
+    plus.e -= 10;
+    // The lower boundary is closer at powers of two, the gap below is smaller.
+    bool const closer = v.f == 1ULL << 52 && biased > 1;
+    DiyFp minus = {(v.f << (closer ? 2 : 1)) - 1, v.e - (closer ? 2 : 1)};
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    // Cached power bringing the upper boundary's exponent into [-60, -32].
+    double const dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    if (dk - k > 0.0) ++k;
+    size_t const index = (size_t)((k >> 3) + 1);
+    *exp = -(-348 + (int)(index << 3));
+    DiyFp const c = cached_powers[index];
+
+    DiyFp const w = diyfp_mul(diyfp_normalize(v), c);
+    DiyFp wp = diyfp_mul(plus, c);
+    DiyFp wm = diyfp_mul(minus, c);
+    ++wm.f;
+    --wp.f;
+
+    // Generate digits of the integral part of `wp`, then of the fraction,
+    // stopping once the rest is within `delta` of it.
+    int const shift = -wp.e;
+    uint64_t const one = 1ULL << shift;
+    uint64_t const wp_w = wp.f - w.f;
+    uint64_t delta = wp.f - wm.f;
+    uint32_t p1 = (uint32_t)(wp.f >> shift);
+    uint64_t p2 = wp.f & (one - 1);
+    int kappa = 1;
+    while (kappa < 10 && p1 >= pow10[kappa]) ++kappa;
+    int len = 0;
+    while (kappa > 0) {
+        uint32_t const d = (uint32_t)(p1 / pow10[kappa - 1]);
+        p1 %= (uint32_t)pow10[kappa - 1];
+        if (d || len) digits[len++] = (char)('0' + d);
+        --kappa;
+        uint64_t const rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta) {
+            *exp += kappa;
+            grisu_round(digits, len, delta, rest, pow10[kappa] << shift, wp_w);
+            return len;
+        }
+    }
+    while (true) {
+        p2 *= 10;
+        delta *= 10;
+        char const d = (char)(p2 >> shift);
+        if (d || len) digits[len++] = (char)('0' + d);
+        p2 &= one - 1;
+        --kappa;
+        if (p2 < delta) {
+            *exp += kappa;
+            grisu_round(digits, len, delta, p2, one,
+                    -kappa < 20 ? wp_w * pow10[-kappa] : 0);
+            return len;
+        }
+    }
+}
+
+// Write finite `num` to `str` with the fewest digits that read back as `num`,
+// in the shorter of fixed and scientific notation as `std::to_chars` does;
+// return length, 24 at most.
+static size_t print_double(double const num, char * const str) {
+    size_t n = 0;
+    if (signbit(num)) str[n++] = '-';
+    if (num == 0) {
+        str[n++] = '0';
+        return n;
+    }
+    char digits[20];
+    int exp;
+    int const len = grisu2(num < 0 ? -num : num, digits, &exp);
+    int const point = len + exp; // Position of the decimal point in digits.
+    int e = point - 1;
+    // Use whichever of fixed and scientific notation is shorter.
+    int const fixed_len = point <= 0 ? 2 - point + len
+        : point >= len ? point : len + 1;
+    int const sci_len = (len > 1 ? len + 1 : 1) + (e <= -100 || e >= 100 ? 5 : 4);
+    if (fixed_len <= sci_len) {
+        if (point <= 0) {
+            str[n++] = '0';
+            str[n++] = '.';
+            for (int i = point; i < 0; ++i) str[n++] = '0';
+            memcpy(str + n, digits, len);
+            n += len;
+        } else if (point >= len) {
+            memcpy(str + n, digits, len);
+            n += len;
+            for (int i = len; i < point; ++i) str[n++] = '0';
+        } else {
+            memcpy(str + n, digits, point);
+            n += point;
+            str[n++] = '.';
+            memcpy(str + n, digits + point, len - point);
+            n += len - point;
+        }
+        return n;
+    }
+    str[n++] = digits[0];
+    if (len > 1) {
+        str[n++] = '.';
+        memcpy(str + n, digits + 1, len - 1);
+        n += len - 1;
+    }
+    str[n++] = 'e';
+    str[n++] = e < 0 ? '-' : '+';
+    if (e < 0) e = -e;
+    if (e >= 100) str[n++] = (char)('0' + e / 100);
+    str[n++] = (char)('0' + e / 10 % 10);
+    str[n++] = (char)('0' + e % 10);
+    return n;
+}
+
 // JSON ------------------------------------------------------------------------
 
 JSON *JSON_Create(JSONType const type) {
@@ -133,6 +549,70 @@ JSON *JSON_CreateNumber(double const num) {
     return json;
 }
 
+JSON *JSON_CreateInt64(int64_t const num) {
+    JSON *json = JSON_Create(JSONNumber);
+    if (!json) return json;
+    json->number = (double)num;
+    json->int64 = num;
+    json->numtype = JSONNumberInt64;
+    return json;
+}
+
+JSON *JSON_CreateUint64(uint64_t const num) {
+    JSON *json = JSON_Create(JSONNumber);
+    if (!json) return json;
+    json->number = (double)num;
+    json->uint64 = num;
+    json->numtype = JSONNumberUint64;
+    return json;
+}
+
+bool JSON_GetInt64(JSON const * const json, int64_t * const out) {
+    if (json->type != JSONNumber) return false;
+    switch (json->numtype) {
+    case JSONNumberInt64:
+        *out = json->int64;
+        return true;
+    case JSONNumberUint64:
+        if (json->uint64 > INT64_MAX) return false;
+        *out = (int64_t)json->uint64;
+        return true;
+    case JSONNumberDouble: {
+        double const num = json->number;
+        if (!(num >= -9223372036854775808.0 && num < 9223372036854775808.0)
+                || (double)(int64_t)num != num)
+            return false;
+        *out = (int64_t)num;
+        } return true;
+    }
+    return false;
+}
+
+bool JSON_GetUint64(JSON const * const json, uint64_t * const out) {
+    if (json->type != JSONNumber) return false;
+    switch (json->numtype) {
+    case JSONNumberInt64:
+        if (json->int64 < 0) return false;
+        *out = (uint64_t)json->int64;
+        return true;
+    case JSONNumberUint64:
+        *out = json->uint64;
+        return true;
+    case JSONNumberDouble: {
+        double const num = json->number;
+        if (!(num >= 0 && num < 18446744073709551616.0)
+                || (double)(uint64_t)num != num)
+            return false;
+        *out = (uint64_t)num;
+        } return true;
+    }
+    return false;
+}
+
+double JSON_GetDouble(JSON const * const json) {
+    return json->type == JSONNumber ? json->number : 0;
+}
+
 JSON *JSON_CreateString(char const * const str) {
     size_t str_len = strlen(str);
     char *json_str = (char*)malloc((str_len + 1) * sizeof(*str));
@@ -147,7 +627,78 @@ JSON *JSON_CreateArray(void) {
     return JSON_Create(JSONArray);
 }
 
+// Contiguous copy of the members of a packed JSONArray, allocated in one block
+// with the arrays following the struct.
+struct JSONPacked {
+    size_t length;
+    double *numbers;
+    int64_t *integers; // NULL unless every member is an int64.
+};
+
+static void JSON_ArrayUnpack(JSON * const json) {
+    free(json->packed);
+    json->packed = NULL;
+}
+
+// Allocate packed copy for `len` members, with room for integers if `integral`.
+static struct JSONPacked *JSON_PackedCreate(size_t const len, bool const integral) {
+    size_t const size = sizeof(double) + (integral ? sizeof(int64_t) : 0);
+    if (len > (SIZE_MAX - sizeof(struct JSONPacked)) / size) return NULL;
+    struct JSONPacked *packed = (struct JSONPacked*)malloc(
+            sizeof(*packed) + len * size);
+    if (!packed) return NULL;
+    packed->length = len;
+    packed->numbers = (double*)(packed + 1);
+    packed->integers = integral ? (int64_t*)(packed->numbers + len) : NULL;
+    return packed;
+}
+
+// Packed copy of array members if they are all numbers, built on first use
+// and kept until a child is added; the children are left as they are so the
+// array can still be walked and printed as usual.
+static struct JSONPacked const *JSON_ArrayPacked(JSON const * const json) {
+    if (json->type != JSONArray) return NULL;
+    if (json->packed) return json->packed;
+    size_t len = 0;
+    bool integral = true;
+    for (JSON *walk = json->child; walk != NULL; walk = walk->next) {
+        if (walk->type != JSONNumber) return NULL;
+        if (walk->numtype != JSONNumberInt64) integral = false;
+        ++len;
+    }
+    if (len == 0) return NULL;
+    struct JSONPacked *packed = JSON_PackedCreate(len, integral);
+    if (!packed) return NULL;
+    size_t i = 0;
+    for (JSON *walk = json->child; walk != NULL; walk = walk->next, ++i) {
+        packed->numbers[i] = walk->number;
+        if (integral) packed->integers[i] = walk->int64;
+    }
+    // Stored even through a const struct, like the cached hash.
+    ((JSON*)json)->packed = packed;
+    return packed;
+}
+
+double const *JSON_ArrayDoubles(JSON const * const json, size_t * const len) {
+    struct JSONPacked const * const packed = JSON_ArrayPacked(json);
+    if (!packed) return NULL;
+    if (len) *len = packed->length;
+    return packed->numbers;
+}
+
+int64_t const *JSON_ArrayInt64s(JSON const * const json, size_t * const len) {
+    struct JSONPacked const * const packed = JSON_ArrayPacked(json);
+    if (!packed || !packed->integers) return NULL;
+    if (len) *len = packed->length;
+    return packed->integers;
+}
+
 static void JSON_AddChild(JSON * const parent, JSON * const child) {
+    if (parent->type == JSONArray && parent->packed)
+        JSON_ArrayUnpack(parent);
+    // Parents of a struct without a cached hash don't have one either.
+    for (JSON *walk = parent; walk != NULL && walk->hash; walk = walk->parent)
+        walk->hash = 0;
     child->parent = parent;
     if (parent->child == NULL) {
         parent->child = child;
@@ -161,6 +712,18 @@ static void JSON_AddChild(JSON * const parent, JSON * const child) {
     }
 }
 
+// Add child after `*last`, the current last child of parent, avoiding the walk
+// down the list done by `JSON_AddChild`.
+static void JSON_LinkChild(JSON * const parent, JSON ** const last,
+        JSON * const child) {
+    child->parent = parent;
+    child->prev = *last;
+    child->next = NULL;
+    if (*last) (*last)->next = child;
+    else parent->child = child;
+    *last = child;
+}
+
 JSON *JSON_CreatePair(char * const name, JSON * const val) {
     JSON *pair = JSON_Create(JSONPair);
     if (!pair) return NULL;
@@ -285,6 +848,31 @@ JSON *JSON_ObjectAddObject(JSON * const json,
     return JSON_ObjectAdd(json, name, json_obj);
 }
 
+// Print string in quotes, escaping characters which may not appear as is.
+static bool JSON_PrintString(char const *str, CBuf * const buf) {
+    if (!cbuf_append(buf, '"')) return false;
+    for (; *str != '\0'; ++str) {
+        unsigned char const c = *str;
+        char escape[8] = {'\\', 0};
+        switch (c) {
+        case '"':  escape[1] = '"';  break;
+        case '\\': escape[1] = '\\'; break;
+        case '\b': escape[1] = 'b';  break;
+        case '\f': escape[1] = 'f';  break;
+        case '\n': escape[1] = 'n';  break;
+        case '\r': escape[1] = 'r';  break;
+        case '\t': escape[1] = 't';  break;
+        default:
+            if (c < 0x20) snprintf(escape, sizeof(escape), "\\u%04x", c);
+            else escape[0] = '\0';
+            break;
+        }
+        if (escape[0] ? !cbuf_append_str(buf, escape) : !cbuf_append(buf, c))
+            return false;
+    }
+    return cbuf_append(buf, '"');
+}
+
 static bool JSON_Print_(JSON const * const json, CBuf * const buf) {
     JSON *child = NULL;
     switch (json->type) {
@@ -296,20 +884,29 @@ static bool JSON_Print_(JSON const * const json, CBuf * const buf) {
             return false;
         break;
     case JSONNumber: {
-        char const *fmt = "%lg";
-        int number_len = snprintf(NULL, 0, fmt, json->number);
-        if (number_len < 0) return false;
-        while (number_len + 1 > cbuf_remaining(buf)) cbuf_grow(buf);
-        if (snprintf(buf->items + buf->size, number_len + 1,
-                    fmt, json->number)
-                < 1)
-            return false;
-        buf->size += number_len;
+        // Integers are printed exactly, doubles with the fewest digits that
+        // read back as the same value.
+        char number_str[32];
+        switch (json->numtype) {
+        case JSONNumberInt64:
+            snprintf(number_str, sizeof(number_str), "%" PRId64, json->int64);
+            break;
+        case JSONNumberUint64:
+            snprintf(number_str, sizeof(number_str), "%" PRIu64, json->uint64);
+            break;
+        case JSONNumberDouble:
+            // JSON has no infinity or NaN, print them as null like
+            // `rtb_json::print`.
+            if (isfinite(json->number))
+                number_str[print_double(json->number, number_str)] = '\0';
+            else
+                strcpy(number_str, "null");
+            break;
+        }
+        if (!cbuf_append_str(buf, number_str)) return false;
         } break;
     case JSONString:
-        cbuf_append(buf, '"');
-        cbuf_append_str(buf, json->string);
-        cbuf_append(buf, '"');
+        if (!JSON_PrintString(json->string, buf)) return false;
         break;
     case JSONArray:
         cbuf_append(buf, '[');
@@ -350,17 +947,485 @@ char *JSON_Print(JSON const * const json) {
     return str;
 }
 
-void JSON_Delete(JSON *json) {
+// hash ------------------------------------------------------------------------
+//
+// Hashes are computed bottom up and cached in each struct, so a struct whose
+// hash has been computed has its children's hashes cached too. Object members
+// are combined by addition so their order doesn't matter.
+
+static uint64_t JSON_HashNumber(JSON const * const json) {
+    int64_t i64;
+    uint64_t u64;
+    if (JSON_GetInt64(json, &i64)) return hash_mix((uint64_t)i64 ^ JSONNumber);
+    if (JSON_GetUint64(json, &u64)) return hash_mix(u64 ^ JSONNumber);
+    return hash_bytes(&json->number, sizeof(json->number), JSONNumber);
+}
+
+uint64_t JSON_Hash(JSON const * const json) {
+    if (json->hash) return json->hash;
+    uint64_t h = hash_mix(json->type + 1);
+    switch (json->type) {
+    case JSONNull:
+        break;
+    case JSONBool:
+        h = hash_mix(h + json->boolval);
+        break;
+    case JSONNumber:
+        h = JSON_HashNumber(json);
+        break;
+    case JSONString:
+        h = hash_bytes(json->string, strlen(json->string), JSONString);
+        break;
+    case JSONArray:
+        for (JSON const *walk = json->child; walk != NULL; walk = walk->next)
+            h = hash_mix(h ^ JSON_Hash(walk)) * 0x9e3779b97f4a7c15ULL;
+        break;
+    case JSONPair:
+        h = hash_mix(JSON_Hash(json->child) * 0x9e3779b97f4a7c15ULL
+                ^ JSON_Hash(json->child->next));
+        break;
+    case JSONObject: {
+        uint64_t sum = 0;
+        for (JSON const *walk = json->child; walk != NULL; walk = walk->next)
+            sum += JSON_Hash(walk);
+        h = hash_mix(h ^ sum);
+        } break;
+    }
+    if (h == 0) h = 1;
+    // Cached even through a const struct, the value doesn't change.
+    ((JSON*)json)->hash = h;
+    return h;
+}
+
+static bool JSON_Equal_(JSON const * const a, JSON const * const b);
+
+static size_t JSON_CountEqual(JSON const *walk, JSON const * const pair) {
+    size_t count = 0;
+    for (; walk != NULL; walk = walk->next)
+        if (walk->hash == pair->hash && JSON_Equal_(walk, pair))
+            ++count;
+    return count;
+}
+
+static int JSON_HashCompare(void const * const a, void const * const b) {
+    uint64_t const a_hash = (*(JSON const * const *)a)->hash;
+    uint64_t const b_hash = (*(JSON const * const *)b)->hash;
+    return (a_hash > b_hash) - (a_hash < b_hash);
+}
+
+// Compare members of objects with `len` members each. Members of both are
+// sorted by hash so equal members line up, only members within a run of equal
+// hashes are compared with each other. Small objects, or if allocation fails,
+// count occurrences of each member in both instead.
+static bool JSON_EqualMembers(JSON const * const a, JSON const * const b,
+        size_t const len) {
+    JSON const **a_members = len > 8
+        ? (JSON const**)malloc(2 * len * sizeof(*a_members))
+        : NULL;
+    if (!a_members) {
+        // Each member must occur as often in both, which also handles
+        // duplicate names.
+        for (JSON const *walk = a->child; walk != NULL; walk = walk->next)
+            if (JSON_CountEqual(a->child, walk)
+                    != JSON_CountEqual(b->child, walk))
+                return false;
+        return true;
+    }
+    JSON const **b_members = a_members + len;
+    size_t i = 0;
+    for (JSON const *walk = a->child; walk != NULL; walk = walk->next)
+        a_members[i++] = walk;
+    i = 0;
+    for (JSON const *walk = b->child; walk != NULL; walk = walk->next)
+        b_members[i++] = walk;
+    qsort(a_members, len, sizeof(*a_members), JSON_HashCompare);
+    qsort(b_members, len, sizeof(*b_members), JSON_HashCompare);
+    bool equal = true;
+    for (i = 0; equal && i < len; ++i)
+        equal = a_members[i]->hash == b_members[i]->hash;
+    // Match each member of a run to an equal one of the same run, moving
+    // matched members of `b` to the front of the run.
+    for (i = 0; equal && i < len; ++i) {
+        size_t k = i;
+        while (k < len && b_members[k]->hash == a_members[i]->hash
+                && !JSON_Equal_(a_members[i], b_members[k]))
+            ++k;
+        if (k == len || b_members[k]->hash != a_members[i]->hash) {
+            equal = false;
+        } else {
+            JSON const * const matched = b_members[k];
+            b_members[k] = b_members[i];
+            b_members[i] = matched;
+        }
+    }
+    free(a_members);
+    return equal;
+}
+
+// Compare structs whose hashes are cached and equal.
+static bool JSON_Equal_(JSON const * const a, JSON const * const b) {
+    if (a == b) return true;
+    if (a->type != b->type || a->hash != b->hash) return false;
+    switch (a->type) {
+    case JSONNull:
+        return true;
+    case JSONBool:
+        return a->boolval == b->boolval;
+    case JSONNumber: {
+        int64_t a_i64, b_i64;
+        uint64_t a_u64, b_u64;
+        if (JSON_GetInt64(a, &a_i64) && JSON_GetInt64(b, &b_i64))
+            return a_i64 == b_i64;
+        if (JSON_GetUint64(a, &a_u64) && JSON_GetUint64(b, &b_u64))
+            return a_u64 == b_u64;
+        return a->number == b->number;
+        }
+    case JSONString:
+        return strcmp(a->string, b->string) == 0;
+    case JSONArray: {
+        JSON const *a_walk = a->child, *b_walk = b->child;
+        for (; a_walk && b_walk; a_walk = a_walk->next, b_walk = b_walk->next)
+            if (!JSON_Equal_(a_walk, b_walk))
+                return false;
+        return a_walk == NULL && b_walk == NULL;
+        }
+    case JSONPair:
+        return strcmp(a->child->string, b->child->string) == 0
+            && JSON_Equal_(a->child->next, b->child->next);
+    case JSONObject: {
+        size_t a_len = 0, b_len = 0;
+        for (JSON const *walk = a->child; walk != NULL; walk = walk->next)
+            ++a_len;
+        for (JSON const *walk = b->child; walk != NULL; walk = walk->next)
+            ++b_len;
+        return a_len == b_len && JSON_EqualMembers(a, b, a_len);
+        }
+    }
+    return false;
+}
+
+bool JSON_Equal(JSON const * const a, JSON const * const b) {
+    if (JSON_Hash(a) != JSON_Hash(b)) return false;
+    return JSON_Equal_(a, b);
+}
+
+// binary ----------------------------------------------------------------------
+//
+// Encoded form is the magic "RTBJ" followed by the root node. Each node is a
+// tag byte followed by its payload; lengths and integers are LEB128 varints
+// (signed integers zigzag encoded) and doubles are 8 bytes in host byte order,
+// so encoded data is meant to be decoded on the same kind of machine.
+
+enum {
+    BinNull,
+    BinFalse,
+    BinTrue,
+    BinDouble,     // 8 byte double
+    BinInt64,      // zigzag varint
+    BinUint64,     // varint
+    BinString,     // varint length, bytes
+    BinArray,      // varint count, nodes
+    BinPair,       // string bytes as for BinString without tag, node
+    BinObject,     // varint count, pairs without tag
+    BinDoubles,    // varint count, 8 byte doubles: array of doubles
+    BinInt64s,     // varint count, zigzag varints: array of int64
+};
+
+static char const bin_magic[4] = {'R', 'T', 'B', 'J'};
+
+static uint64_t zigzag_encode(int64_t val) {
+    return ((uint64_t)val << 1) ^ (uint64_t)(val < 0 ? -1 : 0);
+}
+static int64_t zigzag_decode(uint64_t val) {
+    return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+static bool JSON_Encode_(JSON const * const json, CBuf * const buf);
+
+static bool JSON_EncodeString(char const * const str, CBuf * const buf) {
+    size_t const len = strlen(str);
+    return cbuf_append_varint(buf, len) && cbuf_append_bytes(buf, str, len);
+}
+
+static bool JSON_EncodeChildren(JSON const * const json, CBuf * const buf) {
+    size_t count = 0;
+    for (JSON const *walk = json->child; walk != NULL; walk = walk->next)
+        ++count;
+    if (!cbuf_append_varint(buf, count)) return false;
+    for (JSON const *walk = json->child; walk != NULL; walk = walk->next) {
+        if (json->type == JSONObject) {
+            if (!JSON_EncodeString(walk->child->string, buf)
+                    || !JSON_Encode_(walk->child->next, buf))
+                return false;
+        } else if (!JSON_Encode_(walk, buf)) return false;
+    }
+    return true;
+}
+
+// Encode array whose members are all int64s or all doubles as a single block,
+// otherwise node by node; members are read from the children rather than the
+// packed copy, which is not updated when a child is modified directly.
+static bool JSON_EncodeArray(JSON const * const json, CBuf * const buf) {
+    size_t count = 0;
+    bool doubles = true, integers = true;
+    for (JSON const *walk = json->child; walk != NULL; walk = walk->next) {
+        if (walk->type != JSONNumber) {
+            doubles = integers = false;
+            break;
+        }
+        JSONNumberType const numtype = walk->numtype;
+        doubles = doubles && numtype == JSONNumberDouble;
+        integers = integers && numtype == JSONNumberInt64;
+        ++count;
+    }
+    if (count == 0 || (!doubles && !integers))
+        return cbuf_append(buf, BinArray) && JSON_EncodeChildren(json, buf);
+    if (!cbuf_append(buf, integers ? BinInt64s : BinDoubles)
+            || !cbuf_append_varint(buf, count))
+        return false;
+    for (JSON const *walk = json->child; walk != NULL; walk = walk->next) {
+        if (integers
+                ? !cbuf_append_varint(buf, zigzag_encode(walk->int64))
+                : !cbuf_append_bytes(buf, &walk->number, sizeof(walk->number)))
+            return false;
+    }
+    return true;
+}
+
+static bool JSON_Encode_(JSON const * const json, CBuf * const buf) {
+    switch (json->type) {
+    case JSONNull:
+        return cbuf_append(buf, BinNull);
+    case JSONBool:
+        return cbuf_append(buf, json->boolval ? BinTrue : BinFalse);
+    case JSONNumber:
+        switch (json->numtype) {
+        case JSONNumberInt64:
+            return cbuf_append(buf, BinInt64)
+                && cbuf_append_varint(buf, zigzag_encode(json->int64));
+        case JSONNumberUint64:
+            return cbuf_append(buf, BinUint64)
+                && cbuf_append_varint(buf, json->uint64);
+        case JSONNumberDouble:
+            return cbuf_append(buf, BinDouble)
+                && cbuf_append_bytes(buf, &json->number, sizeof(json->number));
+        }
+        return false;
+    case JSONString:
+        return cbuf_append(buf, BinString)
+            && JSON_EncodeString(json->string, buf);
+    case JSONArray:
+        return JSON_EncodeArray(json, buf);
+    case JSONPair:
+        return cbuf_append(buf, BinPair)
+            && JSON_EncodeString(json->child->string, buf)
+            && JSON_Encode_(json->child->next, buf);
+    case JSONObject:
+        return cbuf_append(buf, BinObject) && JSON_EncodeChildren(json, buf);
+    }
+    return false;
+}
+
+unsigned char *JSON_Encode(JSON const * const json, size_t * const len) {
+    CBuf buf = {0};
+    unsigned char *bytes = NULL;
+    if (cbuf_append_bytes(&buf, bin_magic, sizeof(bin_magic))
+            && JSON_Encode_(json, &buf)
+            && (bytes = (unsigned char*)malloc(buf.size))) {
+        memcpy(bytes, buf.items, buf.size);
+        *len = buf.size;
+    }
+    cbuf_delete(&buf);
+    return bytes;
+}
+
+// Input of `JSON_Decode`, every read is checked against `end`.
+typedef struct BinReader {
+    unsigned char const *pos;
+    unsigned char const *end;
+} BinReader;
+
+static bool bin_read_varint(BinReader * const in, uint64_t * const val) {
+    *val = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in->pos == in->end) return false;
+        unsigned char const byte = *(in->pos++);
+        *val |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static bool bin_read_bytes(BinReader * const in, void * const out, size_t len) {
+    if ((size_t)(in->end - in->pos) < len) return false;
+    memcpy(out, in->pos, len);
+    in->pos += len;
+    return true;
+}
+
+// Read count of following elements, each of which takes at least `min_size`
+// bytes, so that a corrupt count fails before anything is allocated.
+static bool bin_read_count(BinReader * const in, size_t min_size,
+        uint64_t * const count) {
+    return bin_read_varint(in, count)
+        && *count <= (uint64_t)(in->end - in->pos) / min_size;
+}
+
+static JSON *JSON_DecodeString(BinReader * const in) {
+    uint64_t len;
+    if (!bin_read_count(in, 1, &len)) return NULL;
+    char *str = (char*)malloc(len + 1);
+    if (!str) return NULL;
+    bin_read_bytes(in, str, len);
+    str[len] = '\0';
+    JSON *json = JSON_Create(JSONString);
+    if (!json) {
+        free(str);
+        return NULL;
+    }
+    json->string = str;
+    return json;
+}
+
+static JSON *JSON_Decode_(BinReader * const in, int const depth);
+
+// Decode pair without tag: string bytes followed by value.
+static JSON *JSON_DecodePair(BinReader * const in, int const depth) {
+    JSON *pair = JSON_Create(JSONPair);
+    if (!pair) return NULL;
+    JSON *key, *val;
+    if (!(key = JSON_DecodeString(in))) goto fail;
+    JSON_AddChild(pair, key);
+    if (!(val = JSON_Decode_(in, depth))) goto fail;
+    JSON_AddChild(pair, val);
+    return pair;
+fail:
+    JSON_Delete(pair);
+    return NULL;
+}
+
+// Decode children of array or object nested `depth` deep.
+static bool JSON_DecodeChildren(JSON * const json, BinReader * const in,
+        int const depth) {
+    uint64_t count;
+    if (!bin_read_count(in, 1, &count)) return false;
+    JSON *last = NULL;
+    for (uint64_t i = 0; i < count; ++i) {
+        JSON *child = json->type == JSONObject
+            ? JSON_DecodePair(in, depth)
+            : JSON_Decode_(in, depth);
+        if (!child) return false;
+        JSON_LinkChild(json, &last, child);
+    }
+    return true;
+}
+
+// Decode block of doubles or int64s into the children of an array.
+static bool JSON_DecodePacked(JSON * const json, BinReader * const in,
+        bool const integral) {
+    uint64_t count;
+    if (!bin_read_count(in, integral ? 1 : sizeof(double), &count)
+            || count == 0)
+        return false;
+    JSON *last = NULL;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t val;
+        double num;
+        JSON *child;
+        if (integral) {
+            if (!bin_read_varint(in, &val)) return false;
+            child = JSON_CreateInt64(zigzag_decode(val));
+        } else {
+            bin_read_bytes(in, &num, sizeof(num));
+            child = JSON_CreateNumber(num);
+        }
+        if (!child) return false;
+        JSON_LinkChild(json, &last, child);
+    }
+    return true;
+}
+
+// Decode node at nesting `depth`, failing like the parser at MAX_DEPTH to keep
+// stack usage bounded.
+static JSON *JSON_Decode_(BinReader * const in, int const depth) {
+    if (in->pos == in->end) return NULL;
+    unsigned char const tag = *(in->pos++);
+    uint64_t val;
+    JSON *json = NULL;
+    switch (tag) {
+    case BinNull:
+        return JSON_CreateNull();
+    case BinFalse:
+    case BinTrue:
+        return JSON_CreateBool(tag == BinTrue);
+    case BinDouble: {
+        double num;
+        if (!bin_read_bytes(in, &num, sizeof(num))) return NULL;
+        return JSON_CreateNumber(num);
+        }
+    case BinInt64:
+        if (!bin_read_varint(in, &val)) return NULL;
+        return JSON_CreateInt64(zigzag_decode(val));
+    case BinUint64:
+        if (!bin_read_varint(in, &val)) return NULL;
+        return JSON_CreateUint64(val);
+    case BinString:
+        return JSON_DecodeString(in);
+    case BinPair:
+        if (depth >= MAX_DEPTH) return NULL;
+        return JSON_DecodePair(in, depth + 1);
+    case BinArray:
+    case BinObject:
+        if (depth >= MAX_DEPTH) return NULL;
+        if (!(json = JSON_Create(tag == BinArray ? JSONArray : JSONObject)))
+            return NULL;
+        if (!JSON_DecodeChildren(json, in, depth + 1)) goto fail;
+        return json;
+    case BinDoubles:
+    case BinInt64s:
+        if (!(json = JSON_CreateArray())) return NULL;
+        if (!JSON_DecodePacked(json, in, tag == BinInt64s)) goto fail;
+        return json;
+    }
+    return NULL;
+fail:
+    JSON_Delete(json);
+    return NULL;
+}
+
+JSON *JSON_Decode(unsigned char const * const bytes, size_t const len) {
+    BinReader in = {bytes, bytes + len};
+    if (len < sizeof(bin_magic) || memcmp(bytes, bin_magic, sizeof(bin_magic)))
+        return NULL;
+    in.pos += sizeof(bin_magic);
+    JSON *json = JSON_Decode_(&in, 0);
+    if (json && in.pos != in.end) {
+        JSON_Delete(json);
+        return NULL;
+    }
+    return json;
+}
+
+// Delete data and children of JSON struct, but not the struct itself.
+static void JSON_DeleteContents(JSON * const json) {
     switch (json->type) {
     case JSONString:
         if (json->string != NULL) free(json->string);
         break;
+    case JSONArray:
+        JSON_ArrayUnpack(json);
+        break;
     }
     JSON *walk = json->child;
     while (walk != NULL) {
+        JSON *walk_next = walk->next;
         JSON_Delete(walk);
-        walk = walk->next;
+        walk = walk_next;
     }
+}
+
+void JSON_Delete(JSON *json) {
+    JSON_DeleteContents(json);
     free(json);
 }
 
@@ -369,18 +1434,55 @@ void JSON_Delete(JSON *json) {
 // TODO: Explain how parser works and difference between functions which take
 // CBuf or JSON as input, and return bool or JSON as output.
 //
-// TODO: Add more error messages signaling input errors.
+// Errors are recorded in `parse_error` by `parse_fail`, only the first error is
+// kept as the functions up the call stack fail in turn.
+
+// Parser state is thread local so separate threads can parse concurrently.
 
 // Copy of input string to work with during parsing.
-static char const *input_str;
-static int input_len;
-static int input_i;
+static THREAD_LOCAL char const *input_str;
+static THREAD_LOCAL size_t input_len;
+static THREAD_LOCAL size_t input_i;
 
 // Buffer used as temporary memory during number/string parsing.
-static CBuf parse_buf = {0};
+static THREAD_LOCAL CBuf parse_buf = {0};
+
+// First error encountered while parsing input.
+static THREAD_LOCAL JSONError parse_error;
+
+// Number of arrays and objects containing the value being parsed.
+static THREAD_LOCAL int parse_depth;
 
 char next(void) { return input_str[input_i]; }
 
+static void describe_char(char *str, size_t size, char c) {
+    if (c == '\0')
+        snprintf(str, size, "end of input");
+    else if (' ' <= c && c <= '~')
+        snprintf(str, size, "'%c'", c);
+    else
+        snprintf(str, size, "byte 0x%02x", (unsigned char)c);
+}
+
+// Record error at current input position, `expected` describes what the parser
+// was looking for.
+static bool parse_fail(JSONErrorCode code, char const *expected) {
+    if (parse_error.code != JSONErrorNone) return false;
+    parse_error.code = code;
+    parse_error.offset = input_i;
+    snprintf(parse_error.expected, sizeof(parse_error.expected),
+            "%s", expected);
+    describe_char(parse_error.found, sizeof(parse_error.found), next());
+    if (code == JSONErrorMemory)
+        snprintf(parse_error.message, sizeof(parse_error.message),
+                "failed to allocate %s", expected);
+    else
+        snprintf(parse_error.message, sizeof(parse_error.message),
+                "expected %s, found %s", parse_error.expected, parse_error.found);
+    print_error(parse_error.message);
+    return false;
+}
+
 bool consume(void) {
     if (input_i < input_len) {
         ++input_i;
@@ -414,8 +1516,9 @@ bool expect(char c) {
         consume();
         return true;
     }
-    fprintf(stderr, "error: expect: expected '%c', received '%c'\n", c, next());
-    return false;
+    char expected[24];
+    describe_char(expected, sizeof(expected), c);
+    return parse_fail(JSONErrorSyntax, expected);
 }
 bool expect_str(char const *str) {
     while (*str) {
@@ -438,10 +1541,10 @@ int next_bool(void) {
 }
 bool parse_bool(JSON *json, int len) {
     if (len == 4) {
-        expect_str("true");
+        if (!expect_str("true")) return false;
         json->boolval = true;
     } else if (len == 5) {
-        expect_str("false");
+        if (!expect_str("false")) return false;
         json->boolval = false;
     } else return false;
     json->type = JSONBool;
@@ -468,13 +1571,12 @@ bool parse_digits(CBuf *buf) {
 bool parse_natural0(CBuf *buf) {
     if (next() == '0') {
         parse_digit(buf);
-        if (char_isdigit(next())) {
-            print_error("parse_natural0: digits follow leading zero");
-            return false;
-        }
+        if (char_isdigit(next()))
+            return parse_fail(JSONErrorSyntax, "non-digit after 0");
         return true;
     }
-    return parse_digits(buf);
+    if (!parse_digits(buf)) return parse_fail(JSONErrorSyntax, "digit");
+    return true;
 }
 
 bool parse_exponent(CBuf *buf) {
@@ -485,7 +1587,37 @@ bool parse_exponent(CBuf *buf) {
     return parse_digits(buf);
 }
 
+// Set exact value of number from integer string `str`, failing if it does not
+// fit in an int64 or uint64.
+static bool parse_integer(JSON *json, char const *str) {
+    bool const negative = *str == '-';
+    if (negative) ++str;
+    uint64_t val = 0;
+    for (; *str; ++str) {
+        uint64_t const digit = *str - '0';
+        if (val > (UINT64_MAX - digit) / 10) return false;
+        val = val * 10 + digit;
+    }
+    if (negative) {
+        // "-0" is kept as a double to preserve its sign.
+        if (val == 0 || val > (uint64_t)INT64_MAX + 1) return false;
+        json->int64 = (int64_t)(0 - val);
+        json->numtype = JSONNumberInt64;
+        json->number = (double)json->int64;
+    } else if (val <= INT64_MAX) {
+        json->int64 = (int64_t)val;
+        json->numtype = JSONNumberInt64;
+        json->number = (double)json->int64;
+    } else {
+        json->uint64 = val;
+        json->numtype = JSONNumberUint64;
+        json->number = (double)json->uint64;
+    }
+    return true;
+}
+
 bool parse_number(JSON *json) {
+    bool integral = true;
     cbuf_clear(&parse_buf);
     // Parse integer part of number.
     if (next() == '-') {
@@ -495,35 +1627,64 @@ bool parse_number(JSON *json) {
     if (!parse_natural0(&parse_buf)) return false;
     // Parse fraction part of number.
     if (next() == '.') {
+        integral = false;
         consume();
         cbuf_append(&parse_buf, '.');
-        if (!parse_digits(&parse_buf)) return false;
+        if (!parse_digits(&parse_buf))
+            return parse_fail(JSONErrorSyntax, "digit");
     }
     // Parse fraction part of number.
     if (next() == 'e' || next() == 'E') {
+        integral = false;
         cbuf_append(&parse_buf, next());
         consume();
-        if (!parse_exponent(&parse_buf)) return false;
+        if (!parse_exponent(&parse_buf))
+            return parse_fail(JSONErrorSyntax, "digit");
     }
 
     cbuf_append(&parse_buf, '\0');
-    if (sscanf(parse_buf.items, "%lg", &(json->number)) < 1)
-        return false;
+    if (!integral || !parse_integer(json, parse_buf.items)) {
+        json->number = strtod(parse_buf.items, NULL);
+        json->numtype = JSONNumberDouble;
+    }
 
     json->type = JSONNumber;
     return true;
 }
 
-// TODO: Add string escape '\'.
 bool parse_string(JSON *json) {
     cbuf_clear(&parse_buf);
     if (!expect('"')) return false;
-    while (next() != '"') {
-        cbuf_append(&parse_buf, next());
-        if (!consume()) return false;
+    while (true) {
+        size_t const run =
+            str_plain_len(input_str + input_i, input_len - input_i);
+        if (!cbuf_append_bytes(&parse_buf, input_str + input_i, run))
+            return parse_fail(JSONErrorMemory, "string");
+        input_i += run;
+        unsigned char const c = next();
+        size_t len;
+        if (c == '"') {
+            break;
+        } else if (c == '\\') {
+            uint32_t code;
+            consume();
+            len = escape_len(input_str + input_i, input_len - input_i, &code);
+            if (!len) return parse_fail(JSONErrorSyntax, "escape sequence");
+            cbuf_append_utf8(&parse_buf, code);
+        } else if (c == '\0') {
+            return parse_fail(JSONErrorSyntax, "'\"'");
+        } else if (c < 0x20) {
+            return parse_fail(JSONErrorSyntax, "escaped control char");
+        } else {
+            len = utf8_sequence_len(input_str + input_i, input_len - input_i);
+            if (!len) return parse_fail(JSONErrorSyntax, "UTF-8 sequence");
+            cbuf_append_bytes(&parse_buf, input_str + input_i, len);
+        }
+        consume_n(len);
     }
-    if (!expect('"')) return false;
-    json->string = cbuf_print(&parse_buf);
+    consume();
+    if (!(json->string = cbuf_print(&parse_buf)))
+        return parse_fail(JSONErrorMemory, "string");
     json->type = JSONString;
     return true;
 }
@@ -531,6 +1692,10 @@ bool parse_string(JSON *json) {
 JSON *parse_value(void);
 
 bool parse_array(JSON *json) {
+    JSON *last = NULL;
+    if (parse_depth == MAX_DEPTH)
+        return parse_fail(JSONErrorSyntax, "less nesting");
+    ++parse_depth;
     if (!expect('[')) return false;
     consume_whitespace();
     if (next() == ']') {
@@ -540,13 +1705,14 @@ bool parse_array(JSON *json) {
     while (true) {
         JSON *child = parse_value();
         if (!child) return false;
-        JSON_AddChild(json, child);
+        JSON_LinkChild(json, &last, child);
         if (next() != ',')
             break;
         consume();
     }
     if (!expect(']')) return false;
 done:
+    --parse_depth;
     json->type = JSONArray;
     return true;
 }
@@ -554,30 +1720,34 @@ done:
 JSON *parse_pair(void) {
     JSON *pair = (JSON*)calloc(1, sizeof(JSON));
     if (!pair) {
-        print_error("parse_pair: failed to allocate JSON");
+        parse_fail(JSONErrorMemory, "JSON");
         return NULL;
     }
     JSON *key = (JSON*)calloc(1, sizeof(JSON));
     if (!key) {
-        print_error("parse_pair: failed to allocate JSON");
-        return NULL;
+        parse_fail(JSONErrorMemory, "JSON");
+        goto fail;
     }
+    JSON_AddChild(pair, key);
     JSON *val; // set by `parse_value`
     consume_whitespace();
     if (!parse_string(key)) goto fail;
     consume_whitespace();
     if (!expect(':')) goto fail;
     if (!(val = parse_value())) goto fail;
-    JSON_AddChild(pair, key);
     JSON_AddChild(pair, val);
     pair->type = JSONPair;
     return pair;
 fail:
-    free(pair);
+    JSON_Delete(pair);
     return NULL;
 }
 
 bool parse_object(JSON *json) {
+    JSON *last = NULL;
+    if (parse_depth == MAX_DEPTH)
+        return parse_fail(JSONErrorSyntax, "less nesting");
+    ++parse_depth;
     if (!expect('{')) return false;
     consume_whitespace();
     if (next() == '}') {
@@ -587,13 +1757,14 @@ bool parse_object(JSON *json) {
     while (true) {
         JSON *pair = parse_pair();
         if (!pair) return false;
-        JSON_AddChild(json, pair);
+        JSON_LinkChild(json, &last, pair);
         if (next() != ',')
             break;
         consume();
     }
     if (!expect('}')) return false;
 done:
+    --parse_depth;
     json->type = JSONObject;
     return true;
 }
@@ -601,7 +1772,7 @@ done:
 JSON *parse_value(void) {
     JSON *json = (JSON*)calloc(1, sizeof(JSON));
     if (!json) {
-        print_error("parse_value: failed to allocate JSON");
+        parse_fail(JSONErrorMemory, "JSON");
         return NULL;
     }
     consume_whitespace();
@@ -619,21 +1790,800 @@ JSON *parse_value(void) {
     } else if (next() == '{') {
         if (!parse_object(json)) goto fail;
     } else {
+        parse_fail(JSONErrorSyntax, "value");
         goto fail;
     }
     consume_whitespace();
     return json;
 fail:
-    free(json);
+    // Children added before the failure are deleted with `json`.
+    JSON_Delete(json);
     return NULL;
 }
 
-JSON *JSON_Parse(char const * const str) {
+JSON *JSON_ParseEx(char const * const str, JSONError * const err) {
     input_str = str;
     input_len = strlen(input_str);
     input_i = 0;
+    parse_depth = 0;
+    memset(&parse_error, 0, sizeof(parse_error));
     JSON *json = parse_value();
     cbuf_delete(&parse_buf);
-    if (!json || !expect('\0')) return NULL;
+    if (json && !expect('\0')) {
+        JSON_Delete(json);
+        json = NULL;
+    }
+    if (!json && err) {
+        // Line and column are only needed on failure, find them here rather
+        // than tracking them while parsing.
+        *err = parse_error;
+        err->line = err->column = 1;
+        for (size_t i = 0; i < err->offset; ++i) {
+            if (str[i] == '\n') {
+                ++err->line;
+                err->column = 1;
+            } else ++err->column;
+        }
+    }
     return json;
 }
+
+JSON *JSON_Parse(char const * const str) {
+    return JSON_ParseEx(str, NULL);
+}
+
+// validator -------------------------------------------------------------------
+//
+// Checks input against the same grammar as the parser without building
+// anything. Instead of recursing, the kind of each open container is kept in a
+// bit stack, one bit per level of nesting.
+
+static char const *validate_space(char const *str, char const *end) {
+    // Indentation comes in runs of spaces, skip 8 at a time.
+    while (end - str >= 8 && memcmp(str, "        ", 8) == 0) str += 8;
+    while (str < end && char_isspace(*str)) ++str;
+    return str;
+}
+
+// Return end of string beginning with the '"' at `str`, or NULL if invalid.
+static char const *validate_string(char const *str, char const *end) {
+    ++str;
+    while (true) {
+        str += str_plain_len(str, end - str);
+        if (str == end) return NULL;
+        unsigned char const c = *str;
+        size_t len;
+        uint32_t code;
+        if (c == '"') {
+            return str + 1;
+        } else if (c == '\\') {
+            if (!(len = escape_len(str + 1, end - str - 1, &code)))
+                return NULL;
+            ++len;
+        } else if (c < 0x20) {
+            return NULL;
+        } else if (!(len = utf8_sequence_len(str, end - str))) {
+            return NULL;
+        }
+        str += len;
+    }
+}
+
+static char const *validate_digits(char const *str, char const *end) {
+    if (str == end || !char_isdigit(*str)) return NULL;
+    while (str < end && char_isdigit(*str)) ++str;
+    return str;
+}
+
+// Return end of number beginning at `str`, or NULL if invalid.
+static char const *validate_number(char const *str, char const *end) {
+    if (str < end && *str == '-') ++str;
+    if (str < end && *str == '0') ++str;
+    else if (!(str = validate_digits(str, end))) return NULL;
+    if (str < end && *str == '.')
+        if (!(str = validate_digits(str + 1, end))) return NULL;
+    if (str < end && (*str == 'e' || *str == 'E')) {
+        ++str;
+        if (str < end && (*str == '+' || *str == '-')) ++str;
+        if (!(str = validate_digits(str, end))) return NULL;
+    }
+    return str;
+}
+
+static char const *validate_literal(char const *str, char const *end,
+        char const *literal) {
+    size_t const len = strlen(literal);
+    if ((size_t)(end - str) < len || memcmp(str, literal, len) != 0)
+        return NULL;
+    return str + len;
+}
+
+bool JSON_Validate(char const * const buf, size_t const len) {
+    uint64_t objects[MAX_DEPTH / 64]; // Set bit: container is an object.
+    size_t depth = 0;
+    char const *str = buf;
+    char const *end = buf + len;
+value:
+    str = validate_space(str, end);
+    if (str == end) return false;
+    switch (*str) {
+    case '[':
+    case '{': {
+        bool const object = *str == '{';
+        if (depth == MAX_DEPTH) return false;
+        if (object) objects[depth / 64] |= (uint64_t)1 << depth % 64;
+        else objects[depth / 64] &= ~((uint64_t)1 << depth % 64);
+        ++depth;
+        str = validate_space(str + 1, end);
+        if (str < end && *str == (object ? '}' : ']')) {
+            ++str;
+            --depth;
+            goto after_value;
+        }
+        if (object) goto key;
+        goto value;
+        }
+    case '"': str = validate_string(str, end); break;
+    case 't': str = validate_literal(str, end, "true"); break;
+    case 'f': str = validate_literal(str, end, "false"); break;
+    case 'n': str = validate_literal(str, end, "null"); break;
+    default:
+        if (*str != '-' && !char_isdigit(*str)) return false;
+        str = validate_number(str, end);
+        break;
+    }
+    if (!str) return false;
+after_value:
+    str = validate_space(str, end);
+    if (depth == 0) return str == end;
+    if (str == end) return false;
+    {
+        bool const object = objects[(depth - 1) / 64] >> (depth - 1) % 64 & 1;
+        if (*str == ',') {
+            ++str;
+            if (object) goto key;
+            goto value;
+        }
+        if (*str != (object ? '}' : ']')) return false;
+        ++str;
+        --depth;
+        goto after_value;
+    }
+key:
+    str = validate_space(str, end);
+    if (str == end || *str != '"' || !(str = validate_string(str, end)))
+        return false;
+    str = validate_space(str, end);
+    if (str == end || *str != ':') return false;
+    ++str;
+    goto value;
+}
+
+// text ------------------------------------------------------------------------
+//
+// Reformatting works on the text directly, copying strings and numbers as they
+// are and only changing whitespace between tokens. Input is assumed to be
+// valid, invalid input produces invalid output.
+
+// Return position after the closing '"' of string beginning at `in[i]`.
+static size_t text_string_end(char const * const in, size_t i, size_t len) {
+    ++i;
+    while (i < len) {
+        i += str_plain_len(in + i, len - i);
+        if (i == len) break;
+        if (in[i] == '"') return i + 1;
+        i += in[i] == '\\' ? 2 : 1;
+    }
+    return len;
+}
+
+// Text is scanned 8 bytes at a time using masks with the high bit of a byte
+// set where the byte matches, computed without carries between bytes. Words
+// are loaded so that the first byte in memory is the lowest.
+
+static uint64_t text_load(unsigned char const * const bytes) {
+    uint64_t word = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&word, bytes, 8);
+#else
+    for (int k = 7; k >= 0; --k) word = word << 8 | bytes[k];
+#endif
+    return word;
+}
+
+static uint64_t text_mask_eq(uint64_t const word, char const c) {
+    uint64_t const low7 = 0x7f7f7f7f7f7f7f7fULL;
+    uint64_t const x = word ^ (0x0101010101010101ULL * (unsigned char)c);
+    return ~(((x & low7) + low7) | x) & ~low7;
+}
+
+// Bytes up to ' ', i.e. whitespace outside strings of valid input.
+static uint64_t text_mask_space(uint64_t const word) {
+    uint64_t const low7 = 0x7f7f7f7f7f7f7f7fULL;
+    return ~(((word & low7) + 0x5f5f5f5f5f5f5f5fULL) | word) & ~low7;
+}
+
+// Gather the high bits of a mask into one bit per byte.
+static uint64_t text_mask_bits(uint64_t const mask) {
+    return ((mask >> 7) * 0x0102040810204080ULL) >> 56;
+}
+
+static size_t text_space_end(char const * const in, size_t i, size_t len) {
+    for (; len - i >= 8; i += 8) {
+        uint64_t const token = ~text_mask_space(
+                text_load((unsigned char const*)in + i)) & ~0x7f7f7f7f7f7f7f7fULL;
+        if (token) return i + (size_t)__builtin_ctzll(token) / 8;
+    }
+    while (i < len && (unsigned char)in[i] <= ' ') ++i;
+    return i;
+}
+
+// Minify works on blocks of 64 bytes with a bit per byte for quotes,
+// backslashes and whitespace. String contents are found with a prefix xor of
+// the unescaped quotes, whitespace outside them is dropped and the remaining
+// bytes copied a run at a time.
+size_t JSON_Minify(char const * const in, size_t const len, char * const out) {
+    size_t out_len = 0;
+    uint64_t in_string = 0; // All ones if previous block ended in a string.
+    bool escaped = false;   // Whether first byte of block is escaped.
+    for (size_t i = 0; i < len; i += 64) {
+        size_t const n = len - i < 64 ? len - i : 64;
+        // Output never overtakes input, but may overwrite the current block
+        // when minifying in place, so it is copied first.
+        unsigned char block[64];
+        memcpy(block, in + i, n);
+        memset(block + n, ' ', 64 - n);
+        uint64_t quotes = 0, slashes = 0, spaces = 0;
+        for (int k = 0; k < 8; ++k) {
+            uint64_t const word = text_load(block + 8 * k);
+            quotes |= text_mask_bits(text_mask_eq(word, '"')) << (8 * k);
+            slashes |= text_mask_bits(text_mask_eq(word, '\\')) << (8 * k);
+            spaces |= text_mask_bits(text_mask_space(word)) << (8 * k);
+        }
+        // Mark bytes escaped by a backslash, which is itself not escaped.
+        uint64_t escapes = escaped ? 1 : 0;
+        escaped = false;
+        for (uint64_t walk = slashes; walk; walk &= walk - 1) {
+            int const pos = __builtin_ctzll(walk);
+            if (escapes >> pos & 1) continue;
+            if (pos == 63) escaped = true;
+            else escapes |= 2ULL << pos;
+        }
+        uint64_t string = quotes & ~escapes;
+        for (int shift = 1; shift < 64; shift *= 2) string ^= string << shift;
+        string ^= in_string;
+        in_string = 0 - (string >> 63);
+        uint64_t keep = ~(spaces & ~string);
+        if (n < 64) keep &= (1ULL << n) - 1;
+        // Copy each run of kept bytes at once.
+        while (keep) {
+            int const start = __builtin_ctzll(keep);
+            uint64_t const rest = ~(keep >> start);
+            int const run = rest ? __builtin_ctzll(rest) : 64 - start;
+            memcpy(out + out_len, block + start, (size_t)run);
+            out_len += (size_t)run;
+            keep &= run + start < 64 ? ~0ULL << (run + start) : 0;
+        }
+    }
+    return out_len;
+}
+
+static bool text_newline(CBuf * const buf, size_t const depth,
+        int const indent) {
+    static char const spaces[] = "                                "
+        "                                ";
+    size_t const max_run = sizeof(spaces) - 1;
+    if (!cbuf_append(buf, '\n')) return false;
+    for (size_t n = depth * (size_t)indent; n > 0;) {
+        size_t const run = n < max_run ? n : max_run;
+        if (!cbuf_append_bytes(buf, spaces, run)) return false;
+        n -= run;
+    }
+    return true;
+}
+
+char *JSON_Prettify(char const * const in, size_t const len,
+        int const indent) {
+    if (indent < 0) return NULL;
+    CBuf buf = {0};
+    size_t depth = 0;
+    size_t i = text_space_end(in, 0, len);
+    bool ok = cbuf_reserve(&buf, len + len / 2 + 1);
+    while (ok && i < len) {
+        char const c = in[i];
+        size_t const start = i;
+        switch (c) {
+        case '[':
+        case '{':
+            i = text_space_end(in, i + 1, len);
+            ok = cbuf_append(&buf, c);
+            // Keep empty arrays and objects on one line.
+            if (i < len && in[i] == (c == '[' ? ']' : '}')) {
+                ok = ok && cbuf_append(&buf, in[i++]);
+                break;
+            }
+            ok = ok && text_newline(&buf, ++depth, indent);
+            continue;
+        case ']':
+        case '}':
+            if (depth > 0) --depth;
+            ok = text_newline(&buf, depth, indent) && cbuf_append(&buf, c);
+            ++i;
+            break;
+        case ',':
+            ok = cbuf_append(&buf, c) && text_newline(&buf, depth, indent);
+            i = text_space_end(in, i + 1, len);
+            continue;
+        case ':':
+            ok = cbuf_append_str(&buf, ": ");
+            ++i;
+            break;
+        case '"':
+            i = text_string_end(in, i, len);
+            ok = cbuf_append_bytes(&buf, in + start, i - start);
+            break;
+        default:
+            // Number or literal, ends at the next punctuation.
+            while (i < len && !char_isspace(in[i]) && !strchr("[]{},:\"", in[i]))
+                ++i;
+            if (i == start) ++i;
+            ok = cbuf_append_bytes(&buf, in + start, i - start);
+            break;
+        }
+        i = text_space_end(in, i, len);
+    }
+    char *str = ok ? cbuf_print(&buf) : NULL;
+    cbuf_delete(&buf);
+    return str;
+}
+
+// parallel parser -------------------------------------------------------------
+//
+// A single thread scans the input for the commas separating the members of the
+// top level array, tracking strings and nesting depth, and splits the members
+// into one range per thread. Each thread parses its range into a list of
+// members, the lists are then joined in order under one array.
+
+typedef struct ParseRange {
+    char const *str;
+    size_t start, end; // Members between start and end, excluding the commas.
+    JSON *array;       // Parent of the parsed members.
+    JSON *first, *last;
+    bool ok;
+} ParseRange;
+
+static void *parse_range(void *arg) {
+    ParseRange *range = (ParseRange*)arg;
+    input_str = range->str + range->start;
+    input_len = range->end - range->start;
+    input_i = 0;
+    parse_depth = 1; // Inside the top level array.
+    memset(&parse_error, 0, sizeof(parse_error));
+    range->ok = false;
+    while (true) {
+        JSON *child = parse_value();
+        if (!child) break;
+        // Linked by hand as `JSON_LinkChild` would set the shared parent's
+        // `child` for the first member of every range.
+        child->parent = range->array;
+        child->prev = range->last;
+        if (range->last) range->last->next = child;
+        else range->first = child;
+        range->last = child;
+        if (input_i == input_len) {
+            range->ok = true;
+            break;
+        }
+        if (!expect(',')) break;
+    }
+    cbuf_delete(&parse_buf);
+    return NULL;
+}
+
+// Find end of top level array starting at `str[i]`, the character after '[',
+// storing the position of up to `count - 1` commas splitting the array into
+// ranges of roughly `range_len` bytes in `splits`. Return position of closing
+// ']', or 0 if the array is not closed.
+static size_t parse_split(char const * const str, size_t i,
+        size_t const range_len, size_t * const splits, int const count,
+        int * const split_count) {
+    size_t depth = 0;
+    size_t target = i + range_len;
+    *split_count = 0;
+    for (; str[i] != '\0'; ++i) {
+        char const c = str[i];
+        if (c == '"') {
+            for (++i; str[i] != '"'; ++i) {
+                if (str[i] == '\0') return 0;
+                if (str[i] == '\\' && str[++i] == '\0') return 0;
+            }
+        } else if (c == '[' || c == '{') {
+            ++depth;
+        } else if (c == ']' || c == '}') {
+            if (depth == 0) return c == ']' ? i : 0;
+            --depth;
+        } else if (c == ',' && depth == 0 && i >= target
+                && *split_count < count - 1) {
+            splits[(*split_count)++] = i;
+            target = i + range_len;
+        }
+    }
+    return 0;
+}
+
+JSON *JSON_ParseParallel(char const * const str, int const threads) {
+    size_t const len = strlen(str);
+    size_t begin = 0;
+    while (char_isspace(str[begin])) ++begin;
+    if (threads < 2 || str[begin] != '[') return JSON_Parse(str);
+
+    size_t *splits = (size_t*)malloc((threads - 1) * sizeof(size_t));
+    if (!splits) return NULL;
+    int split_count;
+    size_t const end = parse_split(str, begin + 1, len / threads,
+            splits, threads, &split_count);
+    size_t after = end + 1;
+    while (char_isspace(str[after])) ++after;
+    if (end == 0 || split_count == 0 || str[after] != '\0') {
+        // Nothing to split or malformed input, parse as usual to report it.
+        free(splits);
+        return JSON_Parse(str);
+    }
+
+    int const range_count = split_count + 1;
+    ParseRange *ranges = (ParseRange*)calloc(range_count, sizeof(ParseRange));
+    pthread_t *workers = (pthread_t*)calloc(range_count, sizeof(pthread_t));
+    bool *started = (bool*)calloc(range_count, sizeof(bool));
+    JSON *array = JSON_CreateArray();
+    bool ok = ranges && workers && started && array;
+    for (int i = 0; ok && i < range_count; ++i) {
+        ranges[i].str = str;
+        ranges[i].start = i == 0 ? begin + 1 : splits[i - 1] + 1;
+        ranges[i].end = i == split_count ? end : splits[i];
+        ranges[i].array = array;
+    }
+    if (ok) {
+        // The calling thread parses the first range itself.
+        for (int i = 1; i < range_count; ++i)
+            started[i] = pthread_create(workers + i, NULL,
+                    parse_range, ranges + i) == 0;
+        parse_range(ranges);
+        // Ranges whose thread could not be started are parsed here instead.
+        for (int i = 1; i < range_count; ++i) {
+            if (started[i]) pthread_join(workers[i], NULL);
+            else parse_range(ranges + i);
+        }
+        // Join the lists of members in order, so all of them are deleted with
+        // the array if any range failed.
+        JSON *last = NULL;
+        for (int i = 0; i < range_count; ++i) {
+            ok = ok && ranges[i].ok;
+            if (!ranges[i].first) continue;
+            if (last) last->next = ranges[i].first;
+            else array->child = ranges[i].first;
+            ranges[i].first->prev = last;
+            last = ranges[i].last;
+        }
+    }
+    if (!ok && array) {
+        JSON_Delete(array);
+        array = NULL;
+    }
+    free(splits);
+    free(ranges);
+    free(workers);
+    free(started);
+    return array;
+}
+
+// cache -----------------------------------------------------------------------
+//
+// Entries are split over shards by the hash of their input bytes, each shard
+// with its own lock, hash table and list ordered by last use, so lookups of
+// different inputs rarely contend. The total size of all shards is kept
+// against the budget, when it is exceeded the least recently used entry of
+// all shards is evicted, comparing the last use stamps of their LRU tails. The
+// document root is stored at the start of its entry, so release finds the
+// entry from the root pointer alone. Evicted entries that are still referenced
+// are kept on a list of their shard and freed on their last release.
+
+#define CACHE_SHARDS 16
+
+typedef struct JSONCacheEntry {
+    JSON root;     // Document root, first so the entry is found from it.
+    uint64_t hash;
+    char *key;
+    size_t key_len;
+    size_t shard;
+    size_t size;   // Bytes counted against the cache budget.
+    uint64_t used; // Value of the cache clock when last used.
+    size_t refs;
+    bool cached;   // False once evicted.
+    struct JSONCacheEntry *key_next;            // Hash table chain.
+    struct JSONCacheEntry *lru_prev, *lru_next; // Most recent use first, or
+                                                // evicted list once evicted.
+} JSONCacheEntry;
+
+typedef struct CacheShard {
+    pthread_mutex_t lock;
+    size_t bucket_count; // Power of two.
+    JSONCacheEntry **keys;
+    JSONCacheEntry *lru_head, *lru_tail;
+    JSONCacheEntry *evicted;
+    JSONCacheStats stats;
+} CacheShard;
+
+struct JSONCache {
+    CacheShard shards[CACHE_SHARDS];
+    size_t max_bytes;
+    size_t bytes;   // Total size of cached entries, updated atomically.
+    uint64_t clock; // Counts insertions, updated atomically.
+};
+
+// Approximate heap usage of JSON struct and its children.
+static size_t JSON_Size(JSON const * const json) {
+    size_t size = sizeof(JSON);
+    if (json->type == JSONString && json->string)
+        size += strlen(json->string) + 1;
+    else if (json->type == JSONArray && json->packed)
+        size += sizeof(*json->packed) + json->packed->length
+            * (sizeof(double) + (json->packed->integers ? sizeof(int64_t) : 0));
+    for (JSON const *walk = json->child; walk != NULL; walk = walk->next)
+        size += JSON_Size(walk);
+    return size;
+}
+
+static void cache_lru_unlink(CacheShard * const shard,
+        JSONCacheEntry * const entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else shard->lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else shard->lru_tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void cache_lru_push(CacheShard * const shard,
+        JSONCacheEntry * const entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head) shard->lru_head->lru_prev = entry;
+    else shard->lru_tail = entry;
+    shard->lru_head = entry;
+}
+
+static void cache_entry_delete(JSONCacheEntry * const entry) {
+    JSON_DeleteContents(&entry->root);
+    free(entry->key);
+    free(entry);
+}
+
+// Unlink entry from evicted list of its shard and delete it.
+static void cache_evicted_delete(CacheShard * const shard,
+        JSONCacheEntry * const entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else shard->evicted = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    cache_entry_delete(entry);
+}
+
+static void cache_evict(JSONCache * const cache, CacheShard * const shard,
+        JSONCacheEntry * const entry) {
+    JSONCacheEntry **walk =
+        shard->keys + (entry->hash & (shard->bucket_count - 1));
+    while (*walk != entry) walk = &(*walk)->key_next;
+    *walk = entry->key_next;
+    cache_lru_unlink(shard, entry);
+    entry->cached = false;
+    shard->stats.bytes -= entry->size;
+    __atomic_sub_fetch(&cache->bytes, entry->size, __ATOMIC_RELAXED);
+    --shard->stats.entries;
+    ++shard->stats.evictions;
+    if (entry->refs == 0) {
+        cache_entry_delete(entry);
+        return;
+    }
+    entry->lru_next = shard->evicted;
+    if (shard->evicted) shard->evicted->lru_prev = entry;
+    shard->evicted = entry;
+}
+
+// Evict least recently used entry of all shards, locking one shard at a time;
+// return false if no entries are cached.
+static bool cache_evict_oldest(JSONCache * const cache) {
+    CacheShard *oldest = NULL;
+    uint64_t oldest_used = 0;
+    for (size_t i = 0; i < CACHE_SHARDS; ++i) {
+        CacheShard * const shard = cache->shards + i;
+        pthread_mutex_lock(&shard->lock);
+        if (shard->lru_tail
+                && (!oldest || shard->lru_tail->used < oldest_used)) {
+            oldest = shard;
+            oldest_used = shard->lru_tail->used;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    if (!oldest) return false;
+    // The tail may have changed meanwhile, evicting it regardless is fine.
+    pthread_mutex_lock(&oldest->lock);
+    if (oldest->lru_tail) cache_evict(cache, oldest, oldest->lru_tail);
+    pthread_mutex_unlock(&oldest->lock);
+    return true;
+}
+
+// Double the bucket count once there are more entries than buckets.
+static void cache_grow(CacheShard * const shard) {
+    size_t const count = shard->bucket_count * 2;
+    JSONCacheEntry **keys = (JSONCacheEntry**)calloc(count, sizeof(*keys));
+    if (!keys) return;
+    for (size_t i = 0; i < shard->bucket_count; ++i) {
+        while (shard->keys[i]) {
+            JSONCacheEntry *entry = shard->keys[i];
+            shard->keys[i] = entry->key_next;
+            entry->key_next = keys[entry->hash & (count - 1)];
+            keys[entry->hash & (count - 1)] = entry;
+        }
+    }
+    free(shard->keys);
+    shard->keys = keys;
+    shard->bucket_count = count;
+}
+
+static JSONCacheEntry *cache_find(CacheShard * const shard, uint64_t const hash,
+        char const * const key, size_t const key_len) {
+    JSONCacheEntry *entry = shard->keys[hash & (shard->bucket_count - 1)];
+    for (; entry != NULL; entry = entry->key_next)
+        if (entry->hash == hash && entry->key_len == key_len
+                && memcmp(entry->key, key, key_len) == 0)
+            return entry;
+    return NULL;
+}
+
+// Reference cached entry, moving it to the front of the LRU list.
+// Hits only read the clock, so they don't contend on it.
+static void cache_use(JSONCache * const cache, CacheShard * const shard,
+        JSONCacheEntry * const entry) {
+    ++entry->refs;
+    entry->used = __atomic_load_n(&cache->clock, __ATOMIC_RELAXED);
+    if (shard->lru_head != entry) {
+        cache_lru_unlink(shard, entry);
+        cache_lru_push(shard, entry);
+    }
+}
+
+JSONCache *JSON_CacheCreate(size_t const max_bytes) {
+    JSONCache *cache = (JSONCache*)calloc(1, sizeof(JSONCache));
+    if (!cache) return NULL;
+    cache->max_bytes = max_bytes;
+    size_t i = 0;
+    for (; i < CACHE_SHARDS; ++i) {
+        CacheShard * const shard = cache->shards + i;
+        shard->bucket_count = 16;
+        shard->keys = (JSONCacheEntry**)calloc(shard->bucket_count,
+                sizeof(*shard->keys));
+        if (!shard->keys || pthread_mutex_init(&shard->lock, NULL) != 0) {
+            free(shard->keys);
+            break;
+        }
+    }
+    if (i < CACHE_SHARDS) {
+        while (i-- > 0) {
+            pthread_mutex_destroy(&cache->shards[i].lock);
+            free(cache->shards[i].keys);
+        }
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+JSON const *JSON_CacheParse(JSONCache * const cache, char const * const str) {
+    size_t const len = strlen(str);
+    uint64_t const hash = hash_bytes(str, len, 0);
+    // Top bits pick the shard, low bits the bucket within it.
+    size_t const shard_index = (size_t)(hash >> 60) % CACHE_SHARDS;
+    CacheShard * const shard = cache->shards + shard_index;
+
+    pthread_mutex_lock(&shard->lock);
+    JSONCacheEntry *entry = cache_find(shard, hash, str, len);
+    if (entry) {
+        cache_use(cache, shard, entry);
+        ++shard->stats.hits;
+        pthread_mutex_unlock(&shard->lock);
+        return &entry->root;
+    }
+    ++shard->stats.misses;
+    pthread_mutex_unlock(&shard->lock);
+
+    // Parse without holding the lock, so misses don't serialize lookups.
+    JSON *json = JSON_Parse(str);
+    if (!json) return NULL;
+    entry = (JSONCacheEntry*)calloc(1, sizeof(JSONCacheEntry));
+    char *key = (char*)malloc(len + 1);
+    if (!entry || !key) {
+        free(entry);
+        free(key);
+        JSON_Delete(json);
+        return NULL;
+    }
+    // Move root into the entry, its children now belong to the entry's copy.
+    entry->root = *json;
+    for (JSON *walk = entry->root.child; walk != NULL; walk = walk->next)
+        walk->parent = &entry->root;
+    free(json);
+    // Hash before sharing, so `JSON_Hash` on the document only reads.
+    JSON_Hash(&entry->root);
+    memcpy(key, str, len + 1);
+    entry->hash = hash;
+    entry->key = key;
+    entry->key_len = len;
+    entry->shard = shard_index;
+    entry->size = sizeof(JSONCacheEntry) - sizeof(JSON) + len + 1
+        + JSON_Size(&entry->root);
+    entry->refs = 1;
+    entry->cached = true;
+
+    pthread_mutex_lock(&shard->lock);
+    // Another thread may have cached the same input while this one parsed.
+    JSONCacheEntry *existing = cache_find(shard, hash, str, len);
+    if (existing) {
+        cache_use(cache, shard, existing);
+        pthread_mutex_unlock(&shard->lock);
+        cache_entry_delete(entry);
+        return &existing->root;
+    }
+    if (shard->stats.entries >= shard->bucket_count) cache_grow(shard);
+    size_t const bucket = hash & (shard->bucket_count - 1);
+    entry->key_next = shard->keys[bucket];
+    shard->keys[bucket] = entry;
+    entry->used = __atomic_add_fetch(&cache->clock, 1, __ATOMIC_RELAXED);
+    cache_lru_push(shard, entry);
+    shard->stats.bytes += entry->size;
+    ++shard->stats.entries;
+    size_t bytes =
+        __atomic_add_fetch(&cache->bytes, entry->size, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&shard->lock);
+    while (bytes > cache->max_bytes && cache_evict_oldest(cache))
+        bytes = __atomic_load_n(&cache->bytes, __ATOMIC_RELAXED);
+    return &entry->root;
+}
+
+void JSON_CacheRelease(JSONCache * const cache, JSON const * const json) {
+    JSONCacheEntry * const entry = (JSONCacheEntry*)json;
+    CacheShard * const shard = cache->shards + entry->shard;
+    pthread_mutex_lock(&shard->lock);
+    if (--entry->refs == 0 && !entry->cached)
+        cache_evicted_delete(shard, entry);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void JSON_CacheGetStats(JSONCache * const cache, JSONCacheStats * const stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (size_t i = 0; i < CACHE_SHARDS; ++i) {
+        CacheShard * const shard = cache->shards + i;
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->evictions += shard->stats.evictions;
+        stats->entries += shard->stats.entries;
+        stats->bytes += shard->stats.bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+void JSON_CacheDelete(JSONCache * const cache) {
+    for (size_t i = 0; i < CACHE_SHARDS; ++i) {
+        CacheShard * const shard = cache->shards + i;
+        JSONCacheEntry *lists[2] = {shard->lru_head, shard->evicted};
+        for (size_t j = 0; j < 2; ++j) {
+            JSONCacheEntry *entry = lists[j];
+            while (entry != NULL) {
+                JSONCacheEntry *entry_next = entry->lru_next;
+                cache_entry_delete(entry);
+                entry = entry_next;
+            }
+        }
+        pthread_mutex_destroy(&shard->lock);
+        free(shard->keys);
+    }
+    free(cache);
+}
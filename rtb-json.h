@@ -7,6 +7,8 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef enum {
     JSONNull,
@@ -18,20 +20,74 @@ typedef enum {
     JSONObject,
 } JSONType;
 
+// Representation of the value of a JSONNumber, `number` is always set and
+// `int64`/`uint64` hold the exact value whenever `numtype` is not
+// `JSONNumberDouble`.
+typedef enum {
+    JSONNumberDouble,
+    JSONNumberInt64,
+    JSONNumberUint64,
+} JSONNumberType;
+
 typedef struct JSON {
     JSONType type;
+    JSONNumberType numtype;   // Representation of a JSONNumber.
     struct JSON *parent;
     struct JSON *child;       // Head of linked list of children.
     struct JSON *prev, *next; // Prev and next sibling in parent's child list.
+    uint64_t hash;            // Cached `JSON_Hash`, 0 if not yet computed.
     union {
         bool boolval;
         double number;
         char *string;
+        struct JSONPacked *packed; // NULL unless array is packed.
+    };
+    union { // Exact value of a JSONNumber, as given by `numtype`.
+        int64_t int64;
+        uint64_t uint64;
     };
 } JSON;
 
+typedef enum {
+    JSONErrorNone,
+    JSONErrorSyntax, // Input does not match the grammar.
+    JSONErrorMemory, // Allocation failed during parsing.
+} JSONErrorCode;
+
+// Description of the first error encountered by `JSON_ParseEx`.
+typedef struct JSONError {
+    JSONErrorCode code;
+    size_t offset;      // Byte offset of the error in the input.
+    int line, column;   // Position of the error, both starting at 1.
+    char expected[24];  // What the parser expected, e.g. "':'".
+    char found[24];     // What the parser found instead, e.g. "'}'".
+    char message[64];   // Combined description, e.g. "expected ':', found '}'".
+} JSONError;
+
 // Construct a JSON struct by parsing a string; must be `JSON_Delete`d.
+// NOTE: `JSON_ParseEx` returns NULL on failure and fills `err` (if not NULL)
+//       with a description of the error, no output is written.
+// NOTE: Strings are null-terminated, so a string containing the escape
+//       "\u0000" ends at it, e.g. "a\u0000b" is parsed as "a".
 JSON *JSON_Parse(char const * const str);
+JSON *JSON_ParseEx(char const * const str, JSONError * const err);
+
+// Construct a JSON struct by parsing a string like `JSON_Parse`, using up to
+// `threads` threads to parse the members of a top level array; must be
+// `JSON_Delete`d. Other inputs are parsed by the calling thread alone.
+JSON *JSON_ParseParallel(char const * const str, int const threads);
+
+// Check whether the `len` bytes at `buf` are valid JSON without constructing
+// anything; agrees with `JSON_Parse` on every input without a NUL byte, uses
+// no heap memory.
+// NOTE: A NUL byte is invalid like any other control character, whereas
+//       `JSON_Parse` stops at it, e.g. for "1\0" only `JSON_Parse` succeeds.
+// NOTE: Arrays and objects nested more than 1024 deep are rejected by both.
+bool JSON_Validate(char const * const buf, size_t const len);
+
+// Set function called with a message for each error, NULL (the default)
+// disables error logging.
+void JSON_SetErrorHook(void (*hook)(char const *msg));
 
 // Construct a JSON struct of a given type manually; must be `JSON_Delete`d.
 // JSON_CreateString creates a copy of the string argument.
@@ -39,6 +95,8 @@ JSON *JSON_Create(JSONType const type);
 JSON *JSON_CreateNull(void);
 JSON *JSON_CreateBool(bool const val);
 JSON *JSON_CreateNumber(double const num);
+JSON *JSON_CreateInt64(int64_t const num);
+JSON *JSON_CreateUint64(uint64_t const num);
 JSON *JSON_CreateString(char const * const str);
 JSON *JSON_CreateArray(void);
 JSON *JSON_CreatePair(char * const name, JSON * const val);
@@ -70,12 +128,104 @@ JSON *JSON_ObjectAddString(JSON * const json, char * const name, char const * co
 JSON *JSON_ObjectAddArray(JSON * const json, char * const name, char const * const str);
 JSON *JSON_ObjectAddObject(JSON * const json, char * const name, char const * const str);
 
+// Get value of JSON struct of JSONType "number".
+// NOTE: `JSON_Get{Int64,Uint64}` return false if value is not an integer
+//       exactly representable by the given type.
+// NOTE: `numtype` decides which value is used, after assigning to `number`
+//       directly set `numtype` to `JSONNumberDouble`.
+bool JSON_GetInt64(JSON const * const json, int64_t * const out);
+bool JSON_GetUint64(JSON const * const json, uint64_t * const out);
+double JSON_GetDouble(JSON const * const json);
+
+// Access contiguous copy of the members of a JSONArray containing only
+// numbers; stores member count in `len`. The copy is built on the first call
+// and kept in the array until a value is added to it.
+// NOTE: Return NULL if any member is not a number, `JSON_ArrayInt64s`
+//       additionally returns NULL unless `numtype` of every member is
+//       `JSONNumberInt64`, e.g. for [1, 2.0] since 2.0 is parsed as a double.
+// NOTE: Building the copy writes to the array, so only one thread may call
+//       these on an array at a time until the first call returns. Assigning
+//       to a member directly after that leaves the copy stale.
+double const *JSON_ArrayDoubles(JSON const * const json, size_t * const len);
+int64_t const *JSON_ArrayInt64s(JSON const * const json, size_t * const len);
+
 // Render JSON struct as string, string must be `free`d.
+// NOTE: Infinite and NaN numbers are printed as null.
 char *JSON_Print(JSON const * const json);
 
+// Hash JSON struct by structure and value, independent of the order of object
+// members; the hash of each struct is cached in its `hash` member.
+// NOTE: The `JSON_ArrayAdd*` and `JSON_ObjectAdd*` functions clear cached
+//       hashes, after modifying a struct directly set `hash` to 0 for it and
+//       each of its parents.
+// NOTE: Computing a hash writes it to the struct, so only one thread may hash
+//       a struct at a time; documents from `JSON_CacheParse` are hashed before
+//       they are shared and are safe to hash or compare from any thread.
+uint64_t JSON_Hash(JSON const * const json);
+
+// Compare JSON structs by structure and value, independent of the order of
+// object members, using `JSON_Hash` to reject most unequal structs early.
+// NOTE: Numbers are equal if their exact values are, e.g. 1 and 1.0.
+bool JSON_Equal(JSON const * const a, JSON const * const b);
+
+// Reformat the `len` bytes of JSON text at `in` without parsing it; strings
+// and numbers are copied as they are.
+// NOTE: Input is not validated, see `JSON_Validate`.
+// NOTE: `JSON_Minify` removes all whitespace between tokens, writing `len`
+//       bytes at most to `out`, which may be `in` to minify in place; return
+//       length of output, which is not null-terminated.
+// NOTE: `JSON_Prettify` puts each member on its own line indented by `indent`
+//       spaces per level of nesting; string must be `free`d. Return NULL
+//       if `indent` is negative.
+size_t JSON_Minify(char const * const in, size_t const len, char * const out);
+char *JSON_Prettify(char const * const in, size_t const len, int const indent);
+
+// Encode JSON struct in a compact binary form, e.g. to store or send a parsed
+// document; stores size in `len`, bytes must be `free`d.
+// NOTE: Numbers are stored in binary so decoding skips number conversion, and
+//       arrays whose members are all doubles or all int64s are stored as a
+//       block, read from the members themselves.
+// NOTE: Encoded doubles use host byte order, decode on the same architecture.
+unsigned char *JSON_Encode(JSON const * const json, size_t * const len);
+
+// Construct a JSON struct from bytes made by `JSON_Encode`; must be
+// `JSON_Delete`d. Return NULL if bytes are not a valid encoding.
+// NOTE: Each struct and string is allocated separately as by `JSON_Parse`,
+//       decoding only saves tokenizing and number conversion.
+// NOTE: Arrays and objects nested more than 1024 deep are rejected.
+JSON *JSON_Decode(unsigned char const * const bytes, size_t const len);
+
 // Delete JSON struct and all children.
 void JSON_Delete(JSON * const json);
 
+// Cache of parsed documents keyed by the bytes of their input, so repeated
+// inputs are only parsed once. All functions are safe to call concurrently.
+typedef struct JSONCache JSONCache;
+
+typedef struct JSONCacheStats {
+    size_t hits, misses, evictions;
+    size_t entries; // Documents currently cached.
+    size_t bytes;   // Approximate memory used by cached documents.
+} JSONCacheStats;
+
+// Construct cache which evicts least recently used documents to stay within
+// `max_bytes`; must be `JSON_CacheDelete`d.
+// NOTE: Documents are spread by input over 16 independently locked shards,
+//       `max_bytes` applies to all of them together.
+JSONCache *JSON_CacheCreate(size_t const max_bytes);
+
+// Get document parsed from `str`, parsing it on a miss; NULL if parsing fails.
+// The document is shared and must not be modified, release it with
+// `JSON_CacheRelease` rather than `JSON_Delete`.
+// NOTE: Documents evicted while in use stay valid until released.
+JSON const *JSON_CacheParse(JSONCache * const cache, char const * const str);
+void JSON_CacheRelease(JSONCache * const cache, JSON const * const json);
+
+void JSON_CacheGetStats(JSONCache * const cache, JSONCacheStats * const stats);
+
+// Delete cache and all documents, including those not yet released.
+void JSON_CacheDelete(JSONCache * const cache);
+
 #ifdef __cplusplus
 }
 #endif
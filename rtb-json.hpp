@@ -0,0 +1,412 @@
+// rtb-json - JSON Parser
+// Copyright (C) 2025 Robert Coffey
+// Released under the MIT license.
+//
+// C++ binding of JSON text directly to structs, without constructing JSON
+// structs. Fields of a struct are declared once with `RTB_JSON_BIND`:
+//
+//   struct Bid { std::string id; double price; std::vector<int64_t> cat; };
+//   RTB_JSON_BIND(Bid, id, price, cat)
+//
+//   Bid bid;
+//   bool ok = rtb_json::parse(text, bid);
+//   std::string str = rtb_json::print(bid);
+//
+// Supported field types are bool, arithmetic types, std::string, std::vector
+// of a supported type, and other bound structs. Members missing from the input
+// keep their value, members without a field are skipped.
+
+#ifndef RTB_JSON_HPP
+#define RTB_JSON_HPP
+
+#include "rtb-json.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace rtb_json {
+
+// FNV-1a hash of member names, computed at compile time for declared fields so
+// a member is matched to its field by comparing hashes first.
+constexpr uint64_t name_hash(std::string_view name) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : name) {
+        h ^= (unsigned char)c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+template <typename T, typename M>
+struct Field {
+    std::string_view name;
+    uint64_t hash;
+    M T::*member;
+};
+
+template <typename T, typename M>
+constexpr Field<T, M> field(std::string_view name, M T::*member) {
+    return {name, name_hash(name), member};
+}
+
+// Specialized by `RTB_JSON_BIND` with a tuple `list` of the fields of `T`.
+template <typename T>
+struct Fields;
+
+template <typename T, typename = void>
+struct is_bound : std::false_type {};
+template <typename T>
+struct is_bound<T, std::void_t<decltype(Fields<T>::list)>> : std::true_type {};
+
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+namespace detail {
+
+inline void append_utf8(std::string &str, uint32_t code) {
+    if (code < 0x80) {
+        str += (char)code;
+    } else if (code < 0x800) {
+        str += (char)(0xc0 | (code >> 6));
+        str += (char)(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        str += (char)(0xe0 | (code >> 12));
+        str += (char)(0x80 | ((code >> 6) & 0x3f));
+        str += (char)(0x80 | (code & 0x3f));
+    } else {
+        str += (char)(0xf0 | (code >> 18));
+        str += (char)(0x80 | ((code >> 12) & 0x3f));
+        str += (char)(0x80 | ((code >> 6) & 0x3f));
+        str += (char)(0x80 | (code & 0x3f));
+    }
+}
+
+// Reads values from text already checked by `JSON_Validate`, so only whether
+// values have the type of their field is checked here.
+class Reader {
+public:
+    Reader(char const *pos, char const *end) : pos_(pos), end_(end) {}
+
+    template <typename T>
+    bool read(T &val) {
+        skip_space();
+        if constexpr (std::is_same_v<T, bool>) {
+            if (peek('t')) { val = true; pos_ += 4; return true; }
+            if (peek('f')) { val = false; pos_ += 5; return true; }
+            return false;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            return read_number(val);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            if (!peek('"')) return false;
+            val.clear();
+            read_string(val);
+            return true;
+        } else if constexpr (is_vector<T>::value) {
+            return read_array(val);
+        } else {
+            static_assert(is_bound<T>::value,
+                    "type must be bound with RTB_JSON_BIND");
+            return read_object(val);
+        }
+    }
+
+private:
+    char const *pos_;
+    char const *end_;
+
+    void skip_space() {
+        while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t'
+                    || *pos_ == '\r' || *pos_ == '\n'))
+            ++pos_;
+    }
+    bool peek(char c) const { return pos_ < end_ && *pos_ == c; }
+    bool consume(char c) {
+        skip_space();
+        if (!peek(c)) return false;
+        ++pos_;
+        return true;
+    }
+
+    char const *number_end() const {
+        char const *end = pos_;
+        while (end < end_ && *end && std::strchr("+-.eE0123456789", *end))
+            ++end;
+        return end;
+    }
+
+    // Integers are read exactly, a fraction or exponent fails for an integer.
+    template <typename T>
+    bool read_number(T &val) {
+        char const *end = number_end();
+        std::from_chars_result res;
+        if constexpr (std::is_floating_point_v<T>)
+            res = std::from_chars(pos_, end, val, std::chars_format::general);
+        else
+            res = std::from_chars(pos_, end, val);
+        if (res.ec != std::errc() || res.ptr != end) return false;
+        pos_ = end;
+        return true;
+    }
+
+    static uint32_t hex4(char const *str) {
+        uint32_t val = 0;
+        for (int i = 0; i < 4; ++i) {
+            char const c = str[i];
+            val = (val << 4) | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        return val;
+    }
+
+    void read_string(std::string &str) {
+        ++pos_;
+        while (true) {
+            char const *run = pos_;
+            while (*pos_ != '"' && *pos_ != '\\') ++pos_;
+            str.append(run, pos_ - run);
+            if (*(pos_++) == '"') return;
+            char const c = *(pos_++);
+            switch (c) {
+            case 'b': str += '\b'; break;
+            case 'f': str += '\f'; break;
+            case 'n': str += '\n'; break;
+            case 'r': str += '\r'; break;
+            case 't': str += '\t'; break;
+            case 'u': {
+                uint32_t code = hex4(pos_);
+                pos_ += 4;
+                if (code >= 0xd800 && code <= 0xdbff) {
+                    code = 0x10000 + ((code - 0xd800) << 10)
+                        + (hex4(pos_ + 2) - 0xdc00);
+                    pos_ += 6;
+                }
+                append_utf8(str, code);
+                } break;
+            default: str += c; break;
+            }
+        }
+    }
+
+    template <typename T>
+    bool read_array(T &vec) {
+        vec.clear();
+        if (!consume('[')) return false;
+        if (consume(']')) return true;
+        do {
+            // Read into a local rather than `vec.back()`, which is a proxy
+            // for std::vector<bool>.
+            typename T::value_type elem{};
+            if (!read(elem)) return false;
+            vec.push_back(std::move(elem));
+        } while (consume(','));
+        return consume(']');
+    }
+
+    void skip_value() {
+        skip_space();
+        int depth = 0;
+        do {
+            char const c = *pos_;
+            if (c == '"') {
+                for (++pos_; *pos_ != '"'; ++pos_)
+                    if (*pos_ == '\\') ++pos_;
+                ++pos_;
+            } else if (c == '[' || c == '{') {
+                ++depth;
+                ++pos_;
+            } else if (c == ']' || c == '}') {
+                --depth;
+                ++pos_;
+            } else if (depth > 0) {
+                ++pos_;
+            } else {
+                while (pos_ < end_ && *pos_ && !std::strchr(",]} \t\r\n", *pos_))
+                    ++pos_;
+            }
+        } while (depth > 0);
+    }
+
+    template <typename T>
+    bool read_member(T &obj, std::string_view name) {
+        uint64_t const hash = name_hash(name);
+        bool found = false;
+        bool ok = true;
+        auto match = [&](auto const &field) {
+            if (!found && hash == field.hash && name == field.name) {
+                found = true;
+                ok = read(obj.*(field.member));
+            }
+        };
+        std::apply([&](auto const &... fields) { (match(fields), ...); },
+                Fields<T>::list);
+        if (!found) skip_value();
+        return ok;
+    }
+
+    template <typename T>
+    bool read_object(T &obj) {
+        if (!consume('{')) return false;
+        if (consume('}')) return true;
+        std::string name_buf;
+        do {
+            skip_space();
+            // Names without escapes are used in place.
+            char const *name = ++pos_;
+            while (*pos_ != '"' && *pos_ != '\\') ++pos_;
+            std::string_view name_view(name, pos_ - name);
+            if (*pos_ == '\\') {
+                name_buf.clear();
+                pos_ = name - 1;
+                read_string(name_buf);
+                name_view = name_buf;
+            } else ++pos_;
+            if (!consume(':') || !read_member(obj, name_view)) return false;
+        } while (consume(','));
+        return consume('}');
+    }
+};
+
+class Writer {
+public:
+    std::string str;
+
+    template <typename T>
+    void write(T const &val) {
+        if constexpr (std::is_same_v<T, bool>) {
+            str += val ? "true" : "false";
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            if constexpr (std::is_floating_point_v<T>) {
+                // Not representable in JSON.
+                if (!std::isfinite(val)) {
+                    str += "null";
+                    return;
+                }
+            }
+            // Integers exactly, doubles with the fewest digits that read back
+            // as the same value.
+            char buf[32];
+            std::to_chars_result res = std::to_chars(buf, buf + sizeof(buf), val);
+            str.append(buf, res.ptr - buf);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            write_string(val);
+        } else if constexpr (is_vector<T>::value) {
+            str += '[';
+            for (size_t i = 0; i < val.size(); ++i) {
+                if (i > 0) str += ',';
+                // Binds to a bool copy for std::vector<bool>.
+                typename T::value_type const &elem = val[i];
+                write(elem);
+            }
+            str += ']';
+        } else {
+            static_assert(is_bound<T>::value,
+                    "type must be bound with RTB_JSON_BIND");
+            bool first = true;
+            auto member = [&](auto const &field) {
+                str += first ? "{\"" : ",\"";
+                first = false;
+                str.append(field.name);
+                str += "\":";
+                write(val.*(field.member));
+            };
+            std::apply([&](auto const &... fields) { (member(fields), ...); },
+                    Fields<T>::list);
+            str += first ? "{}" : "}";
+        }
+    }
+
+private:
+    void write_string(std::string const &val) {
+        str += '"';
+        for (unsigned char c : val) {
+            switch (c) {
+            case '"':  str += "\\\""; break;
+            case '\\': str += "\\\\"; break;
+            case '\b': str += "\\b"; break;
+            case '\f': str += "\\f"; break;
+            case '\n': str += "\\n"; break;
+            case '\r': str += "\\r"; break;
+            case '\t': str += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    str += buf;
+                } else str += (char)c;
+                break;
+            }
+        }
+        str += '"';
+    }
+};
+
+} // namespace detail
+
+// Parse JSON text into `val`; return false if text is not valid JSON or does
+// not match the type of `val`, in which case `val` may be partially assigned.
+template <typename T>
+bool parse(std::string_view text, T &val) {
+    if (!JSON_Validate(text.data(), text.size())) return false;
+    detail::Reader reader(text.data(), text.data() + text.size());
+    return reader.read(val);
+}
+
+// Render `val` as JSON text, members in the order fields were declared.
+template <typename T>
+std::string print(T const &val) {
+    detail::Writer writer;
+    writer.write(val);
+    return writer.str;
+}
+
+} // namespace rtb_json
+
+// Declare fields of struct `Type` by member name, up to 16 fields.
+// NOTE: Must be used at global scope with the fully qualified name of `Type`.
+#define RTB_JSON_BIND(Type, ...) \
+    template <> \
+    struct rtb_json::Fields<Type> { \
+        static constexpr auto list = std::make_tuple( \
+            RTB_JSON_FOR_EACH_(RTB_JSON_FIELD_, Type, __VA_ARGS__)); \
+    };
+
+#define RTB_JSON_FIELD_(Type, name) ::rtb_json::field(#name, &Type::name)
+
+#define RTB_JSON_EXPAND_(x) x
+#define RTB_JSON_FE_1_(m, T, x) m(T, x)
+#define RTB_JSON_FE_2_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_1_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_3_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_2_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_4_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_3_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_5_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_4_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_6_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_5_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_7_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_6_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_8_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_7_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_9_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_8_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_10_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_9_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_11_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_10_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_12_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_11_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_13_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_12_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_14_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_13_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_15_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_14_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_16_(m, T, x, ...) m(T, x), RTB_JSON_EXPAND_(RTB_JSON_FE_15_(m, T, __VA_ARGS__))
+#define RTB_JSON_FE_PICK_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, \
+        _13, _14, _15, _16, name, ...) name
+#define RTB_JSON_FOR_EACH_(m, T, ...) \
+    RTB_JSON_EXPAND_(RTB_JSON_FE_PICK_(__VA_ARGS__, \
+        RTB_JSON_FE_16_, RTB_JSON_FE_15_, RTB_JSON_FE_14_, RTB_JSON_FE_13_, \
+        RTB_JSON_FE_12_, RTB_JSON_FE_11_, RTB_JSON_FE_10_, RTB_JSON_FE_9_, \
+        RTB_JSON_FE_8_, RTB_JSON_FE_7_, RTB_JSON_FE_6_, RTB_JSON_FE_5_, \
+        RTB_JSON_FE_4_, RTB_JSON_FE_3_, RTB_JSON_FE_2_, RTB_JSON_FE_1_) \
+        (m, T, __VA_ARGS__))
+
+#endif
@@ -0,0 +1,163 @@
+//------------------------------------------------------------------------------
+// --- USAGE ---
+// bench_binding [COUNT] [ROUNDS]
+//
+// Compare parsing a bid response of COUNT bids into structs ROUNDS times using
+// `rtb_json::parse`, against `JSON_Parse` followed by copying the JSON structs
+// into the same structs by hand. Also compare `rtb_json::print` against
+// `JSON_Print`. Results of both paths are checked to be equal.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../rtb-json.hpp"
+
+struct Bid {
+    std::string id;
+    std::string impid;
+    double price = 0;
+    int64_t w = 0, h = 0;
+    bool deal = false;
+    std::vector<std::string> adomain;
+    bool operator==(Bid const& o) const {
+        return id == o.id && impid == o.impid && price == o.price
+            && w == o.w && h == o.h && deal == o.deal && adomain == o.adomain;
+    }
+};
+RTB_JSON_BIND(Bid, id, impid, price, w, h, deal, adomain)
+
+struct SeatBid {
+    std::string seat;
+    std::vector<Bid> bid;
+    bool operator==(SeatBid const& o) const {
+        return seat == o.seat && bid == o.bid;
+    }
+};
+RTB_JSON_BIND(SeatBid, seat, bid)
+
+struct BidResponse {
+    std::string id;
+    std::string cur;
+    std::vector<SeatBid> seatbid;
+    bool operator==(BidResponse const& o) const {
+        return id == o.id && cur == o.cur && seatbid == o.seatbid;
+    }
+};
+RTB_JSON_BIND(BidResponse, id, cur, seatbid)
+
+std::string make_input(int count) {
+    std::string str = "{\"id\": \"resp-1\", \"seatbid\": [{\"seat\": \"s1\", "
+        "\"bid\": [";
+    for (int i = 0; i < count; ++i) {
+        if (i > 0) str += ", ";
+        str += "{\"id\": \"bid-" + std::to_string(i)
+            + "\", \"impid\": \"imp-" + std::to_string(i % 7)
+            + "\", \"price\": " + std::to_string(i % 100) + ".25"
+            + ", \"adm\": \"<div class=\\\"ad\\\"></div>\""
+            + ", \"w\": 300, \"h\": 250, \"deal\": " + (i % 2 ? "true" : "false")
+            + ", \"adomain\": [\"example.com\", \"ads.example.com\"]}";
+    }
+    return str + "]}], \"cur\": \"USD\"}";
+}
+
+// Generic path: parse to JSON structs, then walk them comparing names.
+void copy_bid(JSON const *obj, Bid& bid) {
+    for (JSON const *pair = obj->child; pair; pair = pair->next) {
+        char const *name = pair->child->string;
+        JSON const *val = pair->child->next;
+        if      (!strcmp(name, "id"))    bid.id = val->string;
+        else if (!strcmp(name, "impid")) bid.impid = val->string;
+        else if (!strcmp(name, "price")) bid.price = JSON_GetDouble(val);
+        else if (!strcmp(name, "w"))     JSON_GetInt64(val, &bid.w);
+        else if (!strcmp(name, "h"))     JSON_GetInt64(val, &bid.h);
+        else if (!strcmp(name, "deal"))  bid.deal = val->boolval;
+        else if (!strcmp(name, "adomain")) {
+            bid.adomain.clear();
+            for (JSON const *s = val->child; s; s = s->next)
+                bid.adomain.push_back(s->string);
+        }
+    }
+}
+
+bool parse_generic(std::string const& str, BidResponse& resp) {
+    JSON *json = JSON_Parse(str.c_str());
+    if (!json) return false;
+    for (JSON const *pair = json->child; pair; pair = pair->next) {
+        char const *name = pair->child->string;
+        JSON const *val = pair->child->next;
+        if      (!strcmp(name, "id"))  resp.id = val->string;
+        else if (!strcmp(name, "cur")) resp.cur = val->string;
+        else if (!strcmp(name, "seatbid")) {
+            resp.seatbid.clear();
+            for (JSON const *seat = val->child; seat; seat = seat->next) {
+                SeatBid& seatbid = resp.seatbid.emplace_back();
+                for (JSON const *p = seat->child; p; p = p->next) {
+                    if (!strcmp(p->child->string, "seat"))
+                        seatbid.seat = p->child->next->string;
+                    else if (!strcmp(p->child->string, "bid"))
+                        for (JSON const *b = p->child->next->child; b; b = b->next)
+                            copy_bid(b, seatbid.bid.emplace_back());
+                }
+            }
+        }
+    }
+    JSON_Delete(json);
+    return true;
+}
+
+template <typename F>
+double time_ms(int rounds, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) f();
+    std::chrono::duration<double, std::milli> d =
+        std::chrono::steady_clock::now() - start;
+    return d.count() / rounds;
+}
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 10000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    std::string input = make_input(count);
+
+    BidResponse generic, typed;
+    if (!parse_generic(input, generic) || !rtb_json::parse(input, typed)
+            || !(generic == typed)) {
+        std::cout << "FAIL: parse results differ" << std::endl;
+        return 1;
+    }
+    std::string printed = rtb_json::print(typed);
+    BidResponse reparsed;
+    if (!rtb_json::parse(printed, reparsed) || !(reparsed == typed)) {
+        std::cout << "FAIL: printed result does not parse back" << std::endl;
+        return 1;
+    }
+
+    double generic_ms = time_ms(rounds, [&] {
+        BidResponse resp;
+        parse_generic(input, resp);
+    });
+    double typed_ms = time_ms(rounds, [&] {
+        BidResponse resp;
+        rtb_json::parse(input, resp);
+    });
+    JSON *json = JSON_Parse(input.c_str());
+    double generic_print_ms = time_ms(rounds, [&] { free(JSON_Print(json)); });
+    JSON_Delete(json);
+    double typed_print_ms = time_ms(rounds, [&] { rtb_json::print(typed); });
+
+    double mb = input.size() / 1e6;
+    std::cout << "input: " << count << " bids, " << mb << " MB" << std::endl
+        << "parse  JSON_Parse + copy: " << generic_ms << " ms ("
+        << mb / generic_ms * 1e3 << " MB/s)" << std::endl
+        << "parse  rtb_json::parse:   " << typed_ms << " ms ("
+        << mb / typed_ms * 1e3 << " MB/s)" << std::endl
+        << "print  JSON_Print:        " << generic_print_ms << " ms" << std::endl
+        << "print  rtb_json::print:   " << typed_print_ms << " ms" << std::endl;
+    return 0;
+}
@@ -1,4 +1,5 @@
 #!/bin/sh
 
-gcc -o test_JSON -g test_JSON.c ../rtb-json.c
-g++ -o test_parser -g -std=c++20 test_parser.cpp ../rtb-json.c
+gcc -o test_JSON -g test_JSON.c ../rtb-json.c -pthread
+g++ -o test_parser -g -std=c++20 test_parser.cpp ../rtb-json.c -pthread
+g++ -o bench_binding -O2 -std=c++20 bench_binding.cpp ../rtb-json.c -pthread
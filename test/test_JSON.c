@@ -66,13 +66,407 @@ bool test_JSONBool(void) {
     return true;
 }
 
+bool test_JSONNumber(void) {
+    char const *cases[] = {
+        "0", "-7", "1.5", "0.1", "1e+100",
+        "9007199254740993", "-9223372036854775808", "18446744073709551615",
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); ++i) {
+        JSON *json = JSON_Parse(cases[i]);
+        if (json == NULL || json->type != JSONNumber)
+            return false;
+        char *str = JSON_Print(json);
+        if (strcmp(str, cases[i]) != 0) {
+            printf("error: invalid JSONNumber string from JSON_Print: '%s'\n",
+                    str);
+            return false;
+        }
+        JSON_Delete(json);
+        free(str);
+    }
+
+    int64_t i64;
+    uint64_t u64;
+    JSON *json = JSON_Parse("9007199254740993");
+    if (!JSON_GetInt64(json, &i64) || i64 != 9007199254740993LL
+            || !JSON_GetUint64(json, &u64) || u64 != 9007199254740993ULL)
+        return false;
+    json->number = 9007199254740992.0;
+    json->numtype = JSONNumberDouble;
+    char *str = JSON_Print(json);
+    if (strcmp(str, "9007199254740992") != 0)
+        return false;
+    free(str);
+    json->number = 2.5;
+    if (JSON_GetInt64(json, &i64) || JSON_GetDouble(json) != 2.5)
+        return false;
+    JSON_Delete(json);
+
+    // Numbers out of range of a double parse as infinity, print as null.
+    json = JSON_Parse("[1e999, -1e999]");
+    str = JSON_Print(json);
+    if (strcmp(str, "[null,null]") != 0) {
+        printf("error: invalid JSONNumber string from JSON_Print: '%s'\n", str);
+        return false;
+    }
+    free(str);
+    JSON_Delete(json);
+
+    json = JSON_CreateUint64(UINT64_MAX);
+    if (JSON_GetInt64(json, &i64)
+            || !JSON_GetUint64(json, &u64) || u64 != UINT64_MAX)
+        return false;
+    JSON_Delete(json);
+
+    return true;
+}
+
+bool test_JSONString(void) {
+    JSON *json = JSON_Parse("\"a\\\"b\\/\\u00e9\\ud83d\\ude00\\u0001\\n\"");
+    if (json == NULL || json->type != JSONString
+            || strcmp(json->string, "a\"b/\xc3\xa9\xf0\x9f\x98\x80\x01\n") != 0)
+        return false;
+    char *str = JSON_Print(json);
+    if (strcmp(str, "\"a\\\"b/\xc3\xa9\xf0\x9f\x98\x80\\u0001\\n\"") != 0) {
+        printf("error: invalid JSONString string from JSON_Print: '%s'\n", str);
+        return false;
+    }
+    JSON_Delete(json);
+    free(str);
+
+    char const *invalid[] = {
+        "\"\\x\"", "\"\\ud800\"", "\"\t\"", "\"\xc0\xaf\"", "\"abc",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(*invalid); ++i)
+        if (JSON_Parse(invalid[i]) != NULL
+                || JSON_Validate(invalid[i], strlen(invalid[i])))
+            return false;
+
+    return true;
+}
+
 // TODO
-bool test_JSONNumber(void) { return true; }
-bool test_JSONString(void) { return true; }
-bool test_JSONArray(void) { return true; }
 bool test_JSONPair(void) { return true; }
 bool test_JSONObject(void) { return true; }
 
+bool test_JSONArray(void) {
+    size_t len = 0;
+    JSON *json = JSON_Parse("[1, 2.5, -3]");
+    if (json == NULL || json->type != JSONArray)
+        return false;
+    double const *numbers = JSON_ArrayDoubles(json, &len);
+    if (numbers == NULL || len != 3
+            || numbers[0] != 1 || numbers[1] != 2.5 || numbers[2] != -3
+            || JSON_ArrayInt64s(json, &len) != NULL) {
+        printf("error: invalid packed JSONArray from JSON_Parse\n");
+        return false;
+    }
+    JSON_Delete(json);
+
+    json = JSON_Parse("[7, 8, 9]");
+    int64_t const *integers = JSON_ArrayInt64s(json, &len);
+    if (integers == NULL || len != 3
+            || integers[0] != 7 || integers[1] != 8 || integers[2] != 9)
+        return false;
+    // Adding a value discards the copy, the next access builds it again.
+    JSON_ArrayAddNumber(json, 10);
+    double const *doubles = JSON_ArrayDoubles(json, &len);
+    if (doubles == NULL || len != 4 || doubles[3] != 10
+            || JSON_ArrayInt64s(json, &len) != NULL)
+        return false;
+    char *str = JSON_Print(json);
+    if (strcmp(str, "[7,8,9,10]") != 0) {
+        printf("error: invalid JSONArray string from JSON_Print: '%s'\n", str);
+        return false;
+    }
+    JSON_Delete(json);
+    free(str);
+
+    json = JSON_Parse("[1, \"a\"]");
+    if (json->packed != NULL || JSON_ArrayDoubles(json, &len) != NULL)
+        return false;
+    JSON_Delete(json);
+
+    json = JSON_Parse("[1, 2.0]");
+    if (json->packed != NULL || JSON_ArrayInt64s(json, &len) != NULL
+            || JSON_ArrayDoubles(json, &len) == NULL || len != 2)
+        return false;
+    JSON_Delete(json);
+
+    return true;
+}
+
+bool test_JSONError(void) {
+    JSONError err;
+    JSON *json = JSON_ParseEx("{\n  \"a\" 1}", &err);
+    if (json != NULL
+            || err.code != JSONErrorSyntax
+            || err.offset != 8 || err.line != 2 || err.column != 7
+            || strcmp(err.expected, "':'") != 0
+            || strcmp(err.found, "'1'") != 0) {
+        printf("error: invalid JSONError from JSON_ParseEx: '%s'\n",
+                err.message);
+        return false;
+    }
+
+    json = JSON_ParseEx("[true, tru]", &err);
+    if (json != NULL || err.offset != 10
+            || strcmp(err.found, "']'") != 0)
+        return false;
+
+    json = JSON_ParseEx("[1, 2]", &err);
+    if (json == NULL) return false;
+    JSON_Delete(json);
+
+    return true;
+}
+
+bool test_JSONBinary(void) {
+    char const *str = "{\"id\":18446744073709551615,\"v\":[1.5,-2,3],"
+        "\"n\":[-1,2,300],\"a\":[null,true,false,\"s\",{}],\"e\":[]}";
+    JSON *json = JSON_Parse(str);
+    size_t len = 0;
+    unsigned char *bytes = JSON_Encode(json, &len);
+    if (bytes == NULL)
+        return false;
+    JSON_Delete(json);
+
+    json = JSON_Decode(bytes, len);
+    if (json == NULL || JSON_Decode(bytes, len - 1) != NULL)
+        return false;
+    char *decoded_str = JSON_Print(json);
+    if (strcmp(decoded_str, str) != 0) {
+        printf("error: invalid JSON string from JSON_Decode: '%s'\n",
+                decoded_str);
+        return false;
+    }
+    if (JSON_ArrayInt64s(json->child->next->next->child->next, &len) == NULL)
+        return false;
+    JSON_Delete(json);
+    free(decoded_str);
+    free(bytes);
+
+    // Members assigned to directly are encoded, not the stale packed copy.
+    json = JSON_Parse("[[1,2,3],[1,2.5]]");
+    json->child->child->number = 42.5;
+    json->child->child->numtype = JSONNumberDouble;
+    json->child->hash = json->hash = 0;
+    bytes = JSON_Encode(json, &len);
+    JSON *decoded = JSON_Decode(bytes, len);
+    if (decoded == NULL || !JSON_Equal(json, decoded))
+        return false;
+    JSON_Delete(decoded);
+    JSON_Delete(json);
+    free(bytes);
+
+    // Arrays nested 1024 deep decode, one more level is rejected.
+    size_t const depth = 1025;
+    bytes = (unsigned char*)malloc(4 + 2 * depth);
+    memcpy(bytes, "RTBJ", 4);
+    for (size_t i = 0; i < depth; ++i) {
+        bytes[4 + 2 * i] = 7; // BinArray
+        bytes[5 + 2 * i] = i + 1 < depth;
+    }
+    if (JSON_Decode(bytes, 4 + 2 * depth) != NULL)
+        return false;
+    bytes[5 + 2 * (depth - 2)] = 0;
+    json = JSON_Decode(bytes, 4 + 2 * (depth - 1));
+    if (json == NULL)
+        return false;
+    JSON_Delete(json);
+    free(bytes);
+
+    return true;
+}
+
+bool test_JSONCache(void) {
+    JSONCacheStats stats;
+    JSONCache *cache = JSON_CacheCreate(1 << 20);
+    JSON const *a = JSON_CacheParse(cache, "{\"a\":[1,2,3]}");
+    JSON const *b = JSON_CacheParse(cache, "{\"a\":[1,2,3]}");
+    JSON const *c = JSON_CacheParse(cache, "[true]");
+    JSON_CacheGetStats(cache, &stats);
+    if (a == NULL || a != b || c == NULL || c == a
+            || JSON_CacheParse(cache, "[") != NULL
+            || stats.hits != 1 || stats.misses != 2 || stats.entries != 2)
+        return false;
+    JSON_CacheRelease(cache, a);
+    JSON_CacheRelease(cache, b);
+    JSON_CacheRelease(cache, c);
+    JSON_CacheDelete(cache);
+
+    // A document using most of the budget is still cached.
+    char str[512] = "[0";
+    for (int i = 1; i < 100; ++i) sprintf(str + strlen(str), ",%d", i);
+    strcat(str, "]");
+    cache = JSON_CacheCreate(64 * 1024);
+    for (int i = 0; i < 10; ++i) {
+        a = JSON_CacheParse(cache, str);
+        if (a == NULL) return false;
+        JSON_CacheRelease(cache, a);
+    }
+    JSON_CacheGetStats(cache, &stats);
+    if (stats.hits != 9 || stats.misses != 1 || stats.entries != 1
+            || stats.evictions != 0 || stats.bytes > 64 * 1024)
+        return false;
+    JSON_CacheDelete(cache);
+
+    // Least recently used document is evicted when the budget is exceeded.
+    cache = JSON_CacheCreate(3 * stats.bytes / 2);
+    a = JSON_CacheParse(cache, str);
+    JSON_CacheRelease(cache, a);
+    b = JSON_CacheParse(cache, "[1]");
+    JSON_CacheRelease(cache, b);
+    str[1] = '9';
+    c = JSON_CacheParse(cache, str);
+    JSON_CacheRelease(cache, c);
+    b = JSON_CacheParse(cache, "[1]");
+    JSON_CacheRelease(cache, b);
+    JSON_CacheGetStats(cache, &stats);
+    if (stats.evictions != 1 || stats.entries != 2 || stats.hits != 1)
+        return false;
+    JSON_CacheDelete(cache);
+
+    // Budget only fits one document, earlier ones are evicted but remain
+    // valid until released.
+    cache = JSON_CacheCreate(1);
+    a = JSON_CacheParse(cache, "[1]");
+    b = JSON_CacheParse(cache, "[2]");
+    JSON_CacheGetStats(cache, &stats);
+    if (stats.evictions != 2 || stats.entries != 0
+            || a->child->number != 1 || b->child->number != 2)
+        return false;
+    JSON_CacheRelease(cache, a);
+    JSON_CacheRelease(cache, b);
+    JSON_CacheDelete(cache);
+
+    return true;
+}
+
+bool test_JSONParallel(void) {
+    size_t const count = 1000;
+    char *str = (char*)malloc(count * 32 + 2);
+    size_t len = 0;
+    str[len++] = '[';
+    for (size_t i = 0; i < count; ++i)
+        len += sprintf(str + len, "%s{\"i\":%zu,\"s\":\"[,]\"}",
+                i ? ", " : "", i);
+    str[len++] = ']';
+    str[len] = '\0';
+
+    JSON *serial = JSON_Parse(str);
+    JSON *parallel = JSON_ParseParallel(str, 4);
+    if (serial == NULL || parallel == NULL)
+        return false;
+    char *serial_str = JSON_Print(serial);
+    char *parallel_str = JSON_Print(parallel);
+    if (strcmp(serial_str, parallel_str) != 0) {
+        printf("error: invalid JSON string from JSON_ParseParallel\n");
+        return false;
+    }
+    JSON_Delete(serial);
+    JSON_Delete(parallel);
+    free(serial_str);
+    free(parallel_str);
+
+    str[len - 1] = ',';
+    if (JSON_ParseParallel(str, 4) != NULL)
+        return false;
+    free(str);
+
+    return true;
+}
+
+bool test_JSONValidate(void) {
+    char str[2 * 1025 + 1];
+    for (int depth = 1024; depth <= 1025; ++depth) {
+        memset(str, '[', depth);
+        memset(str + depth, ']', depth);
+        str[2 * depth] = '\0';
+        JSON *json = JSON_Parse(str);
+        bool const valid = JSON_Validate(str, 2 * depth);
+        if ((json != NULL) != valid || valid != (depth == 1024))
+            return false;
+        if (json) JSON_Delete(json);
+    }
+    char const *doc = " {\"a\" : [1, -2.5e+3, true, null, \"\\u00e9\"]} ";
+    return JSON_Validate(doc, strlen(doc))
+        && !JSON_Validate(doc, strlen(doc) - 3);
+}
+
+bool test_JSONMinify(void) {
+    char str[] = " {\n  \"a b\" : [ 1.50 , {} ],\n  \"c\\\"\": [ ]\n}\n";
+    char *pretty = JSON_Prettify(str, strlen(str), 2);
+    if (strcmp(pretty, "{\n  \"a b\": [\n    1.50,\n    {}\n  ],\n"
+                "  \"c\\\"\": []\n}") != 0) {
+        printf("error: invalid JSON string from JSON_Prettify: '%s'\n",
+                pretty);
+        return false;
+    }
+    free(pretty);
+    if (JSON_Prettify("[1]", 3, -1) != NULL)
+        return false;
+    pretty = JSON_Prettify("[[1]]", 5, 40);
+    if (pretty == NULL || strlen(pretty) != 1 + 1 + 40 + 1 + 1 + 80 + 1
+            + 1 + 40 + 1 + 1 + 1 || pretty[strlen(pretty) - 1] != ']')
+        return false;
+    free(pretty);
+
+    size_t len = JSON_Minify(str, strlen(str), str);
+    str[len] = '\0';
+    if (strcmp(str, "{\"a b\":[1.50,{}],\"c\\\"\":[]}") != 0) {
+        printf("error: invalid JSON string from JSON_Minify: '%s'\n", str);
+        return false;
+    }
+
+    return true;
+}
+
+bool test_JSONHash(void) {
+    JSON *a = JSON_Parse("{\"a\":1,\"b\":[true,null,\"s\"],\"c\":{\"d\":2.5}}");
+    JSON *b = JSON_Parse("{\"c\":{\"d\":2.5},\"b\":[true,null,\"s\"],\"a\":1.0}");
+    JSON *c = JSON_Parse("{\"a\":1,\"b\":[null,true,\"s\"],\"c\":{\"d\":2.5}}");
+    if (JSON_Hash(a) != JSON_Hash(b) || !JSON_Equal(a, b)
+            || JSON_Equal(a, c) || JSON_Equal(b, c))
+        return false;
+
+    // Adding a member clears the cached hashes of the object and its parents.
+    uint64_t const hash = JSON_Hash(a);
+    JSON_ObjectAddNull(a->child->next->next->child->next, "e");
+    if (a->hash != 0 || JSON_Hash(a) == hash || JSON_Equal(a, b))
+        return false;
+    JSON_ObjectAddNull(b->child->child->next, "e");
+    if (!JSON_Equal(a, b))
+        return false;
+    JSON_Delete(a);
+    JSON_Delete(b);
+    JSON_Delete(c);
+
+    a = JSON_Parse("{\"k\":1,\"k\":1,\"j\":2}");
+    b = JSON_Parse("{\"k\":1,\"j\":2,\"j\":2}");
+    if (JSON_Equal(a, b))
+        return false;
+    JSON_Delete(a);
+    JSON_Delete(b);
+
+    // Large objects with members in opposite order, and repeated members.
+    a = JSON_CreateObject();
+    b = JSON_CreateObject();
+    char name[16];
+    for (int i = 0; i < 1000; ++i) {
+        sprintf(name, "m%d", i % 900);
+        JSON_ObjectAddNumber(a, name, i % 900);
+        sprintf(name, "m%d", (999 - i) % 900);
+        JSON_ObjectAddNumber(b, name, (999 - i) % 900);
+    }
+    if (!JSON_Equal(a, b))
+        return false;
+    JSON_Delete(a);
+    JSON_Delete(b);
+
+    return true;
+}
+
 // TODO: Print info which cases failed.
 int main(void) {
     bool (*test_funcs[])(void) = {
@@ -83,6 +477,13 @@ int main(void) {
         test_JSONArray,
         test_JSONPair,
         test_JSONObject,
+        test_JSONError,
+        test_JSONBinary,
+        test_JSONCache,
+        test_JSONParallel,
+        test_JSONValidate,
+        test_JSONMinify,
+        test_JSONHash,
     };
     for (size_t i = 0; i < sizeof(test_funcs) / sizeof(*test_funcs); ++i) {
         bool (*test_func)(void) = test_funcs[i];
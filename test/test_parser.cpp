@@ -12,6 +12,7 @@
 //     n -> failure
 //     i -> either is acceptable
 //   e.g. y_object_empty.json -> should pass.
+//   A case also fails if JSON_Validate disagrees with the parser.
 //------------------------------------------------------------------------------
 
 #include <libgen.h>
@@ -56,10 +57,17 @@ void test_cases(int argc, char **argv) {
 
         std::string str = read_file(path);
         JSON *json = JSON_Parse(str.c_str());
+        bool valid = JSON_Validate(str.c_str(), str.size());
         bool pass = false;
         if      (targ == 0)                pass = true;
         else if (targ > 0 && json != NULL) pass = true;
         else if (targ < 0 && json == NULL) pass = true;
+        // `JSON_Validate` must agree with `JSON_Parse` on every case, except
+        // those containing a NUL which `JSON_Parse` stops at, i.e.
+        // n_multidigit_number_then_00; these are judged by `JSON_Validate`.
+        if (str.find('\0') != std::string::npos)
+            pass = targ == 0 || (targ > 0) == valid;
+        else if (valid != (json != NULL)) pass = false;
         if (json) JSON_Delete(json);
 
         std::cout << "case: " << filename << ' '